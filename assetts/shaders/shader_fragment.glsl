@@ -1,13 +1,16 @@
 #version 330 core
 
-// texture coordinate
-in vec2 texCoord;
+// position within the sprite (repeats every 1 unit) and position of the sprite in the spritesheet
+in vec2 tilePos;
+flat in vec2 tileOffset;
 
 // final color to output to screen
 out vec4 finalColor;
 
 uniform sampler2D texture;
+uniform vec2 spriteUnit;	// size of one sprite in texture coordinates
 
 void main() {
-	finalColor = texture(texture, texCoord);
-}
\ No newline at end of file
+	// wrap within the sprite so merged faces repeat the texture instead of stretching it
+	finalColor = texture(texture, (tileOffset + fract(tilePos)) * spriteUnit);
+}
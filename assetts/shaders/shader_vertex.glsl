@@ -1,16 +1,24 @@
 #version 330 core
 
-// vertex attributes
-layout (location = 0) in vec3 pos;
-layout (location = 1) in vec2 texturePos;
+// packed vertex (see PackedVertex in vertex.h)
+// data.x: x (bits 0-4), y (5-10), z (11-15), face (16-18), texture u (19-24), texture v (25-30)
+// data.y: sprite u offset (bits 0-7), sprite v offset (8-15)
+layout (location = 0) in uvec2 data;
 
-out vec2 texCoord;
+// position of the chunk this vertex belongs to (one per draw, selected by the draw's base instance)
+layout (location = 3) in vec3 chunkPos;
+
+out vec2 tilePos;
+flat out vec2 tileOffset;
 
 // matrix transformations
 uniform mat4 camera;	// includes view and projection
-uniform mat4 model;
 
 void main() {
-	gl_Position = camera * model * vec4(pos, 1);
-	texCoord = texturePos;
-}
\ No newline at end of file
+	// unpack position
+	vec3 pos = vec3(data.x & 31u, (data.x >> 5) & 63u, (data.x >> 11) & 31u);
+
+	gl_Position = camera * vec4(pos + chunkPos, 1);
+	tilePos = vec2((data.x >> 19) & 63u, (data.x >> 25) & 63u);
+	tileOffset = vec2(data.y & 255u, (data.y >> 8) & 255u);
+}
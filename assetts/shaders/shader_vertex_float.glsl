@@ -0,0 +1,21 @@
+#version 330 core
+
+// float vertex attributes (used when PACKED_VERTICES is false)
+layout (location = 0) in vec3 pos;
+layout (location = 1) in vec2 texturePos;
+layout (location = 2) in vec2 spriteOffset;
+
+// position of the chunk this vertex belongs to (one per draw, selected by the draw's base instance)
+layout (location = 3) in vec3 chunkPos;
+
+out vec2 tilePos;
+flat out vec2 tileOffset;
+
+// matrix transformations
+uniform mat4 camera;	// includes view and projection
+
+void main() {
+	gl_Position = camera * vec4(pos + chunkPos, 1);
+	tilePos = texturePos;
+	tileOffset = spriteOffset;
+}
@@ -0,0 +1,863 @@
+#include <iostream>
+#include <chrono>
+#include <random>
+#include <cstring>
+#include <vector>
+#include <set>
+#include <map>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+
+#include "benchmark.h"
+#include "chunk.h"
+#include "chunk_render.h"
+#include "job_system.h"
+#include "chunk_registry.h"
+#include "epoch.h"
+#include "terrain.h"
+#include "world_storage.h"
+#include "region_file.h"
+#include "mapped_file.h"
+#include "block_edit.h"
+#include "profiler.h"
+
+#define BENCHMARK_CHUNK_POS 16000	// chunk position used for benchmark chunks, far away from the world
+#define FACE_CULLING_RUNS 2000		// number of times each face culling implementation is run per chunk type
+#define MESHING_WORLD_CHUNKS 64		// the meshing benchmark world is this many chunks along x and z
+#define MESHING_RUNS 3		// number of times the meshing benchmark world is meshed per worker count (fastest run is kept)
+#define LOOKUP_WORLD_CHUNKS 256		// the lookup benchmark world is this many chunks along x and z, centered on 0
+#define LOOKUP_COUNT 2000000		// number of lookups per access pattern in the lookup benchmark
+#define REGISTRY_STRESS_THREADS 4		// number of writer threads and of reader threads in the chunk registry stress test
+#define REGISTRY_STRESS_OPS 200000		// operations per thread in the chunk registry stress test
+#define REGISTRY_STRESS_KEYS 4096		// keys used by the chunk registry stress test
+#define TERRAIN_WORLD_CHUNKS 32		// the terrain benchmark world is this many chunks along x and z
+#define TERRAIN_RUNS 3		// number of times the terrain benchmark world is generated per noise implementation (fastest run is kept)
+#define TERRAIN_TEST_SEED 1337		// seed of the terrain determinism test
+#define TERRAIN_TEST_CHECKSUM 0x6a93011af64d0611ULL		// checksum of the terrain benchmark world generated with TERRAIN_TEST_SEED
+#define STORAGE_WORLD_CHUNKS 64		// the region storage benchmark world is this many chunks along x and z
+#define STORAGE_DIRECTORY "benchmark_world"		// where the region storage benchmark saves its world (deleted afterwards)
+#define EDIT_COUNT 2000		// number of single block edits per meshing mode and remeshing method in the block edit benchmark
+#define BULK_BOX_SIZE 128		// the bulk edit benchmark fills a box this many blocks along x and z, and half the world height tall
+#define BULK_SPHERE_RADIUS 7.0f		// radius of the sphere the bulk edit benchmark clears out of the box
+#define BULK_PASTE_SIZE 16		// size of the cube of random blocks the bulk edit benchmark pastes
+#define PROFILER_ZONE_COUNT 1000000		// number of empty zones timed by the profiler benchmark
+#define PROFILER_THREADS 4		// number of threads recording zones while the profiler benchmark writes a trace
+#define PROFILER_TEST_TRACE "benchmark_trace.json"		// where the profiler benchmark writes its trace (deleted afterwards)
+#define SAVE_EDIT_STEPS 4		// the dirty saving benchmark saves after editing 0 chunks, then 16 times more each step (16, 256, 4096)
+
+double Benchmark::getTimeNs() {
+	return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Benchmark::runAll() {
+	std::cout << "Running benchmarks..." << std::endl;
+
+	faceCulling();
+	chunkMeshing();
+	chunkLookup();
+	chunkRegistryStress();
+	terrainGeneration();
+	regionStorage();
+	dirtySaving();
+	blockEdits();
+	bulkEdits();
+	profilerZones();
+}
+
+void Benchmark::faceCulling() {
+	BlockId stone = Block::getBlockId("stone");
+	std::mt19937 random = std::mt19937(1234);
+
+	const char* names[3] = { "solid", "empty", "noisy" };
+	for (int type = 0; type < 3; type++) {
+		// center chunk plus its four neighbors, so chunk boundaries are tested as well
+		Chunk* chunks[5];
+		chunks[0] = new Chunk(glm::ivec2(BENCHMARK_CHUNK_POS, BENCHMARK_CHUNK_POS));
+		chunks[1] = new Chunk(glm::ivec2(BENCHMARK_CHUNK_POS, BENCHMARK_CHUNK_POS - CHUNK_SIZE));
+		chunks[2] = new Chunk(glm::ivec2(BENCHMARK_CHUNK_POS + CHUNK_SIZE, BENCHMARK_CHUNK_POS));
+		chunks[3] = new Chunk(glm::ivec2(BENCHMARK_CHUNK_POS, BENCHMARK_CHUNK_POS + CHUNK_SIZE));
+		chunks[4] = new Chunk(glm::ivec2(BENCHMARK_CHUNK_POS - CHUNK_SIZE, BENCHMARK_CHUNK_POS));
+
+		// fill chunks (empty chunks are left as they are)
+		for (Chunk* chunk : chunks) {
+			for (int x = 0; x < CHUNK_SIZE; x++) {
+				for (int y = 0; y < WORLD_HEIGHT; y++) {
+					for (int z = 0; z < CHUNK_SIZE; z++) {
+						if (type == 0 || (type == 2 && random() % 2 == 0)) {
+							chunk->setBlock(stone, x, y, z);
+						}
+					}
+				}
+			}
+		}
+
+		Chunk* center = chunks[0];
+		uint32_t neighborEdges[4][CHUNK_SIZE];
+
+		// per-block implementation
+		double start = getTimeNs();
+		for (int i = 0; i < FACE_CULLING_RUNS; i++) {
+			center->updateBlockFacesPerBlock();
+		}
+		double perBlockNs = (getTimeNs() - start) / FACE_CULLING_RUNS;
+
+		// keep result to compare against
+		uint32_t expected[FACE_COUNT][CHUNK_SIZE][CHUNK_SIZE];
+		memcpy(expected, center->faceMasks, sizeof(expected));
+
+		// bitmask implementation
+		start = getTimeNs();
+		for (int i = 0; i < FACE_CULLING_RUNS; i++) {
+			center->copyNeighborEdges(neighborEdges);
+			center->updateBlockFaces(neighborEdges);
+		}
+		double bitmaskNs = (getTimeNs() - start) / FACE_CULLING_RUNS;
+
+		bool match = memcmp(expected, center->faceMasks, sizeof(expected)) == 0;
+
+		std::cout << "Face culling (" << names[type] << " chunk): per-block " << perBlockNs << " ns, bitmask " << bitmaskNs
+			<< " ns (" << perBlockNs / bitmaskNs << "x)" << (match ? "" : " - RESULTS DIFFER!") << std::endl;
+
+		for (Chunk* chunk : chunks) {
+			delete chunk;
+		}
+	}
+}
+
+void Benchmark::chunkMeshing() {
+	BlockId stone = Block::getBlockId("stone");
+	BlockId grass = Block::getBlockId("grass");
+	std::mt19937 random = std::mt19937(1234);
+
+	// rolling terrain, so chunks have side faces as well as tops
+	std::vector<Chunk*> chunks;
+	for (int chunkX = 0; chunkX < MESHING_WORLD_CHUNKS; chunkX++) {
+		for (int chunkZ = 0; chunkZ < MESHING_WORLD_CHUNKS; chunkZ++) {
+			Chunk* chunk = new Chunk(glm::ivec2(BENCHMARK_CHUNK_POS + chunkX * CHUNK_SIZE, BENCHMARK_CHUNK_POS + chunkZ * CHUNK_SIZE));
+			chunks.push_back(chunk);
+
+			for (int x = 0; x < CHUNK_SIZE; x++) {
+				for (int z = 0; z < CHUNK_SIZE; z++) {
+					int height = WORLD_HEIGHT / 4 + random() % (WORLD_HEIGHT / 4);
+					for (int y = 0; y < height; y++) {
+						chunk->setBlock(y == height - 1 ? grass : stone, x, y, z);
+					}
+				}
+			}
+		}
+	}
+
+	// each worker count gets its own job system, the engine's one is restored afterwards
+	JobSystem* previous = JobSystem::getActive();
+	double singleMs = 0;
+	for (int workers = 1; workers <= JobSystem::getDefaultWorkerCount() + 1; workers++) {
+		JobSystem jobs(workers);
+		jobs.activate();
+
+		double bestMs = 0;
+		for (int run = 0; run < MESHING_RUNS; run++) {
+			for (Chunk* chunk : chunks) {
+				chunk->markFullRemesh();
+			}
+
+			double start = getTimeNs();
+			Chunk::updateAllChunks();
+			double ms = (getTimeNs() - start) / 1000000;
+			if (run == 0 || ms < bestMs) {
+				bestMs = ms;
+			}
+
+			// hand the meshes to their chunks (as the render thread would), so they don't pile up in the queue
+			ChunkRenderState::receiveMeshes();
+		}
+		if (workers == 1) {
+			singleMs = bestMs;
+		}
+
+		JobStats stats = jobs.getStats();
+		std::cout << "Chunk meshing (" << chunks.size() << " chunks, " << workers << " workers): " << bestMs << " ms, "
+			<< chunks.size() / bestMs * 1000 << " chunks/s (" << singleMs / bestMs << "x), " << stats.steals << " steals" << std::endl;
+	}
+	if (previous != nullptr) {
+		previous->activate();
+	}
+
+	for (Chunk* chunk : chunks) {
+		delete chunk;
+	}
+}
+
+// fake chunk pointer which encodes its key, so lookups can be checked without real chunks
+static Chunk* getStressChunk(ChunkKey key) {
+	return (Chunk*) (((uintptr_t) key << 4) | 8);
+}
+
+void Benchmark::chunkLookup() {
+	std::mt19937 random = std::mt19937(1234);
+
+	// same keys in both, fake chunk pointers since they are only compared
+	ChunkRegistry registry;
+	std::map<ChunkKey, Chunk*> map;
+	for (int x = -LOOKUP_WORLD_CHUNKS / 2; x < LOOKUP_WORLD_CHUNKS / 2; x++) {
+		for (int z = -LOOKUP_WORLD_CHUNKS / 2; z < LOOKUP_WORLD_CHUNKS / 2; z++) {
+			ChunkKey key = Chunk::getChunkIndex(x * CHUNK_SIZE, z * CHUNK_SIZE);
+			registry.insert(key, getStressChunk(key));
+			map[key] = getStressChunk(key);
+		}
+	}
+
+	// random: any chunk (plus some missing ones) each time
+	// coherent: block positions walked row by row, like building the world with addBlock
+	std::vector<ChunkKey> patterns[2];
+	for (int i = 0; i < LOOKUP_COUNT; i++) {
+		int x = (int) (random() % (LOOKUP_WORLD_CHUNKS + 8)) - (LOOKUP_WORLD_CHUNKS + 8) / 2;
+		int z = (int) (random() % (LOOKUP_WORLD_CHUNKS + 8)) - (LOOKUP_WORLD_CHUNKS + 8) / 2;
+		patterns[0].push_back(Chunk::getChunkIndex(x * CHUNK_SIZE, z * CHUNK_SIZE));
+	}
+	int worldBlocks = LOOKUP_WORLD_CHUNKS * CHUNK_SIZE;
+	for (int i = 0; i < LOOKUP_COUNT; i++) {
+		int chunkX, chunkZ;
+		Chunk::getChunkPosition(i / worldBlocks % worldBlocks - worldBlocks / 2, i % worldBlocks - worldBlocks / 2, chunkX, chunkZ);
+		patterns[1].push_back(Chunk::getChunkIndex(chunkX, chunkZ));
+	}
+
+	const char* names[2] = { "random", "coherent" };
+	for (int pattern = 0; pattern < 2; pattern++) {
+		// sums of the found pointers, so the lookups aren't optimized out and the results can be compared
+		uintptr_t mapSum = 0;
+		double start = getTimeNs();
+		for (ChunkKey key : patterns[pattern]) {
+			auto entry = map.find(key);
+			mapSum += (entry == map.end()) ? 0 : (uintptr_t) entry->second;
+		}
+		double mapNs = (getTimeNs() - start) / LOOKUP_COUNT;
+
+		uintptr_t registrySum = 0;
+		start = getTimeNs();
+		for (ChunkKey key : patterns[pattern]) {
+			registrySum += (uintptr_t) registry.find(key);
+		}
+		double registryNs = (getTimeNs() - start) / LOOKUP_COUNT;
+
+		std::cout << "Chunk lookup (" << names[pattern] << ", " << registry.size() << " chunks): std::map " << mapNs << " ns, registry " << registryNs
+			<< " ns (" << mapNs / registryNs << "x)" << (mapSum == registrySum ? "" : " - RESULTS DIFFER!") << std::endl;
+	}
+}
+
+void Benchmark::chunkRegistryStress() {
+	ChunkRegistry registry;
+	std::atomic<bool> done(false);
+	std::atomic<long> errors(0);
+	std::atomic<long> found(0);
+	std::vector<std::set<ChunkKey>> expected(REGISTRY_STRESS_THREADS);		// keys each writer left in the registry
+
+	// writer i only uses keys where key % threads = i, so it knows which of its keys should be present
+	auto writer = [&](int index) {
+		std::mt19937 random = std::mt19937(index);
+		std::set<ChunkKey>& keys = expected[index];
+		for (int i = 0; i < REGISTRY_STRESS_OPS; i++) {
+			ChunkKey key = (random() % (REGISTRY_STRESS_KEYS / REGISTRY_STRESS_THREADS)) * REGISTRY_STRESS_THREADS + index;
+			if (random() % 2 == 0) {
+				if (registry.insert(key, getStressChunk(key)) != (keys.count(key) == 0)) {
+					errors++;
+				}
+				keys.insert(key);
+			}
+			else {
+				Chunk* chunk = registry.erase(key);
+				if ((chunk != nullptr) != (keys.count(key) == 1) || (chunk != nullptr && chunk != getStressChunk(key))) {
+					errors++;
+				}
+				keys.erase(key);
+			}
+		}
+	};
+
+	// readers check that every chunk they see belongs to its key
+	auto reader = [&](int index) {
+		std::mt19937 random = std::mt19937(1000 + index);
+		std::vector<Chunk*> chunks;
+		for (int i = 0; i < REGISTRY_STRESS_OPS; i++) {
+			if (i % 1000 == 0) {
+				chunks.clear();
+				registry.getAll(chunks);
+				for (Chunk* chunk : chunks) {
+					if (((uintptr_t) chunk & 15) != 8 || ((uintptr_t) chunk >> 4) >= REGISTRY_STRESS_KEYS) {
+						errors++;
+					}
+				}
+			}
+
+			ChunkKey key = random() % REGISTRY_STRESS_KEYS;
+			Chunk* chunk = registry.find(key);
+			if (chunk != nullptr) {
+				found++;
+				if (chunk != getStressChunk(key)) {
+					errors++;
+				}
+			}
+		}
+	};
+
+	// old maps are freed while the readers are running
+	std::thread collector = std::thread([&] {
+		while (!done) {
+			Epoch::collect();
+			std::this_thread::yield();
+		}
+	});
+
+	double start = getTimeNs();
+	std::vector<std::thread> threads;
+	for (int i = 0; i < REGISTRY_STRESS_THREADS; i++) {
+		threads.push_back(std::thread(writer, i));
+		threads.push_back(std::thread(reader, i));
+	}
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
+	double ms = (getTimeNs() - start) / 1000000;
+
+	done = true;
+	collector.join();
+	Epoch::collect();
+
+	// the registry should hold exactly what the writers left in it
+	size_t expectedCount = 0;
+	for (int i = 0; i < REGISTRY_STRESS_THREADS; i++) {
+		expectedCount += expected[i].size();
+		for (ChunkKey key : expected[i]) {
+			if (registry.find(key) != getStressChunk(key)) {
+				errors++;
+			}
+		}
+	}
+	if (registry.size() != expectedCount) {
+		errors++;
+	}
+
+	long ops = (long) REGISTRY_STRESS_OPS * REGISTRY_STRESS_THREADS * 2;
+	std::cout << "Chunk registry stress (" << REGISTRY_STRESS_THREADS << " writers, " << REGISTRY_STRESS_THREADS << " readers): "
+		<< ops / ms * 1000 << " operations/s (" << found << " read hits), " << Epoch::getRetiredCount() << " objects still retired, "
+		<< errors << " errors" << (errors == 0 ? "" : " - REGISTRY IS BROKEN!") << std::endl;
+}
+
+// fnv-1a hash of every block id in the given chunks
+static uint64_t getTerrainChecksum(const std::vector<Chunk*>& chunks) {
+	uint64_t hash = 14695981039346656037ULL;
+	for (Chunk* chunk : chunks) {
+		for (int x = 0; x < CHUNK_SIZE; x++) {
+			for (int z = 0; z < CHUNK_SIZE; z++) {
+				for (int y = 0; y < WORLD_HEIGHT; y++) {
+					hash = (hash ^ chunk->getBlock(x, y, z)) * 1099511628211ULL;
+				}
+			}
+		}
+	}
+
+	return hash;
+}
+
+void Benchmark::terrainGeneration() {
+	std::vector<Chunk*> chunks;
+	for (int chunkX = 0; chunkX < TERRAIN_WORLD_CHUNKS; chunkX++) {
+		for (int chunkZ = 0; chunkZ < TERRAIN_WORLD_CHUNKS; chunkZ++) {
+			chunks.push_back(new Chunk(glm::ivec2(BENCHMARK_CHUNK_POS + chunkX * CHUNK_SIZE, BENCHMARK_CHUNK_POS + chunkZ * CHUNK_SIZE)));
+		}
+	}
+
+	// generation is timed on this thread only, so chunks/s is per core
+	uint64_t checksums[2];
+	double scalarMs = 0;
+	for (int simd = 0; simd < 2; simd++) {
+		if (simd && !TERRAIN_SIMD) {
+			std::cout << "Terrain generation (sse2): not available on this platform" << std::endl;
+			checksums[simd] = checksums[0];
+			break;
+		}
+
+		TerrainGenerator generator(TERRAIN_TEST_SEED, simd);
+		double bestMs = 0;
+		for (int run = 0; run < TERRAIN_RUNS; run++) {
+			double start = getTimeNs();
+			for (Chunk* chunk : chunks) {
+				generator.generateChunk(chunk);
+			}
+			double ms = (getTimeNs() - start) / 1000000;
+			if (run == 0 || ms < bestMs) {
+				bestMs = ms;
+			}
+		}
+		if (!simd) {
+			scalarMs = bestMs;
+		}
+
+		checksums[simd] = getTerrainChecksum(chunks);
+		std::cout << "Terrain generation (" << (simd ? "sse2" : "scalar") << ", " << chunks.size() << " chunks): " << bestMs << " ms, "
+			<< chunks.size() / bestMs * 1000 << " chunks/s per core (" << scalarMs / bestMs << "x)" << std::endl;
+	}
+
+	// both implementations have to give the same world, and it has to match the one generated when the checksum was recorded
+	bool deterministic = checksums[0] == checksums[1] && checksums[0] == TERRAIN_TEST_CHECKSUM;
+	std::cout << "Terrain determinism (seed " << TERRAIN_TEST_SEED << "): checksum " << std::hex << checksums[0] << ", expected " << TERRAIN_TEST_CHECKSUM
+		<< std::dec << (deterministic ? "" : " - TERRAIN IS NOT DETERMINISTIC!") << std::endl;
+
+	for (Chunk* chunk : chunks) {
+		delete chunk;
+	}
+}
+
+// number of positions where the ids differ from the chunk's blocks
+static int countMismatches(Chunk* chunk, const BlockId* ids) {
+	int mismatches = 0;
+	for (int x = 0; x < CHUNK_SIZE; x++) {
+		for (int z = 0; z < CHUNK_SIZE; z++) {
+			for (int y = 0; y < WORLD_HEIGHT; y++) {
+				if (chunk->getBlock(x, y, z) != ids[(x * CHUNK_SIZE + z) * WORLD_HEIGHT + y]) {
+					mismatches++;
+				}
+			}
+		}
+	}
+
+	return mismatches;
+}
+
+void Benchmark::regionStorage() {
+	std::filesystem::remove_all(STORAGE_DIRECTORY);
+
+	std::vector<Chunk*> chunks;
+	TerrainGenerator terrain(TERRAIN_TEST_SEED);
+	for (int chunkX = 0; chunkX < STORAGE_WORLD_CHUNKS; chunkX++) {
+		for (int chunkZ = 0; chunkZ < STORAGE_WORLD_CHUNKS; chunkZ++) {
+			Chunk* chunk = new Chunk(glm::ivec2(BENCHMARK_CHUNK_POS + chunkX * CHUNK_SIZE, BENCHMARK_CHUNK_POS + chunkZ * CHUNK_SIZE));
+			terrain.generateChunk(chunk);
+			chunks.push_back(chunk);
+		}
+	}
+
+	int errors = 0;
+	BlockId ids[CHUNK_VOLUME];
+	double saveMs, coldMs, warmMs;
+	{
+		WorldStorage storage(STORAGE_DIRECTORY);
+
+		double start = getTimeNs();
+		for (Chunk* chunk : chunks) {
+			errors += !storage.saveChunk(chunk);
+		}
+		saveMs = (getTimeNs() - start) / 1000000;
+
+		// round trip within the same session, and a chunk which was never saved
+		for (Chunk* chunk : chunks) {
+			glm::ivec3 pos = chunk->getPosition();
+			if (!storage.loadChunk(pos.x, pos.z, ids) || countMismatches(chunk, ids) != 0) {
+				errors++;
+			}
+		}
+		if (storage.loadChunk(-BENCHMARK_CHUNK_POS, -BENCHMARK_CHUNK_POS, ids) || storage.hasChunk(BENCHMARK_CHUNK_POS - CHUNK_SIZE, BENCHMARK_CHUNK_POS)) {
+			errors++;
+		}
+	}
+
+	// a chunk which outgrows its sectors has to move without damaging the chunks around it
+	{
+		RegionFile region;
+		region.open(std::string(STORAGE_DIRECTORY) + "/relocation.region");
+
+		BlockStorage small = BlockStorage(CHUNK_VOLUME);
+		BlockStorage large = BlockStorage(CHUNK_VOLUME);
+		for (int i = 0; i < CHUNK_VOLUME; i++) {
+			small.set(i, i % 3);
+			large.set(i, i % 300);		// 16 bits per index, more than one sector
+		}
+
+		std::vector<uint8_t> smallBytes, largeBytes;
+		small.serialize(smallBytes);
+		large.serialize(largeBytes);
+		region.writeChunk(0, smallBytes);
+		region.writeChunk(1, smallBytes);
+		region.writeChunk(0, largeBytes);
+
+		BlockStorage loaded = BlockStorage(CHUNK_VOLUME);
+		for (int index = 0; index < 2; index++) {
+			BlockStorage& expected = (index == 0) ? large : small;
+			if (!region.readChunk(index, loaded)) {
+				errors++;
+				continue;
+			}
+			for (int i = 0; i < CHUNK_VOLUME; i++) {
+				errors += loaded.get(i) != expected.get(i);
+			}
+		}
+	}
+
+	// reopen the world from disk, with its pages dropped from the cache if the os allows it
+	bool cold = true;
+	for (const std::filesystem::directory_entry& file : std::filesystem::directory_iterator(STORAGE_DIRECTORY)) {
+		cold = MappedFile::dropCache(file.path().string()) && cold;
+	}
+	{
+		WorldStorage storage(STORAGE_DIRECTORY);
+
+		for (int pass = 0; pass < 2; pass++) {
+			double start = getTimeNs();
+			for (Chunk* chunk : chunks) {
+				glm::ivec3 pos = chunk->getPosition();
+				if (!storage.loadChunk(pos.x, pos.z, ids) || countMismatches(chunk, ids) != 0) {
+					errors++;
+				}
+			}
+			double ms = (getTimeNs() - start) / 1000000;
+			(pass == 0 ? coldMs : warmMs) = ms;
+		}
+	}
+
+	uintmax_t bytes = 0;
+	for (const std::filesystem::directory_entry& file : std::filesystem::directory_iterator(STORAGE_DIRECTORY)) {
+		bytes += file.file_size();
+	}
+
+	std::cout << "Region storage (" << chunks.size() << " chunks, " << bytes / 1024 << " KB on disk): saved " << chunks.size() / saveMs * 1000 << " chunks/s, loaded "
+		<< chunks.size() / coldMs * 1000 << " chunks/s " << (cold ? "cold" : "(page cache could not be dropped)") << ", " << chunks.size() / warmMs * 1000
+		<< " chunks/s warm (including the round trip check), " << errors << " errors" << (errors == 0 ? "" : " - STORAGE IS BROKEN!") << std::endl;
+
+	std::filesystem::remove_all(STORAGE_DIRECTORY);
+	for (Chunk* chunk : chunks) {
+		delete chunk;
+	}
+}
+
+void Benchmark::dirtySaving() {
+	std::filesystem::remove_all(STORAGE_DIRECTORY);
+	BlockId stone = Block::getBlockId("stone");
+	std::mt19937 random = std::mt19937(1234);
+
+	std::vector<Chunk*> chunks;
+	TerrainGenerator terrain(TERRAIN_TEST_SEED);
+	for (int chunkX = 0; chunkX < STORAGE_WORLD_CHUNKS; chunkX++) {
+		for (int chunkZ = 0; chunkZ < STORAGE_WORLD_CHUNKS; chunkZ++) {
+			Chunk* chunk = new Chunk(glm::ivec2(BENCHMARK_CHUNK_POS + chunkX * CHUNK_SIZE, BENCHMARK_CHUNK_POS + chunkZ * CHUNK_SIZE));
+			terrain.generateChunk(chunk);
+			chunks.push_back(chunk);
+		}
+	}
+
+	// places a stone block at a random spot on top of a chunk, like a player would
+	std::set<Chunk*> edited;
+	auto editChunk = [&](Chunk* chunk) {
+		glm::ivec3 pos = chunk->getPosition();
+		Chunk::addBlock(stone, pos.x + random() % CHUNK_SIZE, WORLD_HEIGHT - 1, pos.z + random() % CHUNK_SIZE);
+		edited.insert(chunk);
+	};
+
+	std::cout << "Dirty saving (" << chunks.size() << " chunks):";
+	{
+		WorldStorage storage(STORAGE_DIRECTORY);
+		storage.startSaving(3600);		// no autosaves during the benchmark
+
+		for (int step = 0; step < SAVE_EDIT_STEPS; step++) {
+			int editCount = (step == 0) ? 0 : 1 << (4 * step);
+			std::shuffle(chunks.begin(), chunks.end(), random);
+			for (int i = 0; i < editCount; i++) {
+				editChunk(chunks[i]);
+			}
+
+			// the scan and snapshots are what an autosave costs before the save thread writes
+			double start = getTimeNs();
+			int queued = 0;
+			for (Chunk* chunk : chunks) {
+				queued += storage.queueSave(chunk);
+			}
+			double queueMs = (getTimeNs() - start) / 1000000;
+
+			// edits have to go on while the save thread writes
+			double longestEdit = 0;
+			int editsWhileWriting = 0;
+			while (storage.getSaveStats().queued != 0) {
+				double editStart = getTimeNs();
+				editChunk(chunks[random() % chunks.size()]);
+				longestEdit = std::max(longestEdit, getTimeNs() - editStart);
+				editsWhileWriting++;
+			}
+			storage.flush();
+			double writeMs = (getTimeNs() - start) / 1000000 - queueMs;
+
+			std::cout << std::endl << "    " << editCount << " edited: " << queued << " saved, " << queueMs << " ms to snapshot, " << writeMs << " ms to write ("
+				<< editsWhileWriting << " edits meanwhile, longest " << longestEdit / 1000 << " us)";
+
+			// the chunks edited meanwhile aren't part of the next step
+			storage.saveAll();
+		}
+	}
+
+	// edited chunks have to load with their edits, the others must not have been saved at all
+	int errors = 0;
+	{
+		WorldStorage storage(STORAGE_DIRECTORY);
+		BlockId ids[CHUNK_VOLUME];
+		for (Chunk* chunk : chunks) {
+			glm::ivec3 pos = chunk->getPosition();
+			if (edited.count(chunk) == 0) {
+				errors += storage.hasChunk(pos.x, pos.z);
+			}
+			else if (!storage.loadChunk(pos.x, pos.z, ids) || countMismatches(chunk, ids) != 0) {
+				errors++;
+			}
+		}
+	}
+	std::cout << std::endl << "    " << edited.size() << " edited chunks reloaded, " << errors << " errors" << (errors == 0 ? "" : " - SAVING IS BROKEN!") << std::endl;
+
+	std::filesystem::remove_all(STORAGE_DIRECTORY);
+	for (Chunk* chunk : chunks) {
+		delete chunk;
+	}
+}
+
+void Benchmark::blockEdits() {
+	BlockId stone = Block::getBlockId("stone");
+	int previousMode = Chunk::getMeshingMode();
+
+	// 3x3 chunks of terrain, edits go into the middle one so its neighbors see the edits on its edges
+	TerrainGenerator terrain(TERRAIN_TEST_SEED);
+	std::vector<Chunk*> chunks;
+	for (int chunkX = 0; chunkX < 3; chunkX++) {
+		for (int chunkZ = 0; chunkZ < 3; chunkZ++) {
+			chunks.push_back(new Chunk(glm::ivec2(BENCHMARK_CHUNK_POS + chunkX * CHUNK_SIZE, BENCHMARK_CHUNK_POS + chunkZ * CHUNK_SIZE)));
+		}
+	}
+	Chunk* center = chunks[4];
+
+	// the same cells are toggled by every run
+	std::mt19937 random = std::mt19937(1234);
+	std::vector<glm::ivec3> edits;
+	int edgeEdits = 0;
+	for (int i = 0; i < EDIT_COUNT; i++) {
+		glm::ivec3 cell = glm::ivec3(random() % CHUNK_SIZE, random() % WORLD_HEIGHT, random() % CHUNK_SIZE);
+		edits.push_back(cell);
+		edgeEdits += cell.x == 0 || cell.x == CHUNK_SIZE - 1 || cell.z == 0 || cell.z == CHUNK_SIZE - 1;
+	}
+
+	for (int mode : { MESHING_NAIVE, MESHING_GREEDY }) {
+		Chunk::setMeshingMode(mode);
+
+		double ms[2];
+		int neighborMeshes[2];
+		int errors = 0;
+		for (int full = 0; full < 2; full++) {
+			for (Chunk* chunk : chunks) {
+				terrain.generateChunk(chunk);
+			}
+			for (Chunk* chunk : chunks) {
+				chunk->updateData();
+			}
+			ChunkRenderState::receiveMeshes();
+
+			// each edit is meshed right away, with the chunks it marked
+			neighborMeshes[full] = 0;
+			double start = getTimeNs();
+			for (glm::ivec3 cell : edits) {
+				center->setBlock(center->hasBlock(cell.x, cell.y, cell.z) ? BLOCK_AIR : stone, cell.x, cell.y, cell.z);
+				for (Chunk* chunk : chunks) {
+					if (chunk->isDataUpdated()) {
+						continue;
+					}
+					if (full) {
+						chunk->fullRemesh = true;
+					}
+					chunk->updateData();
+					neighborMeshes[full] += chunk != center;
+				}
+				ChunkRenderState::receiveMeshes();
+			}
+			ms[full] = (getTimeNs() - start) / 1000000;
+
+			// patched faces and meshes have to be the same as checking every face again
+			if (!full) {
+				for (Chunk* chunk : chunks) {
+					uint32_t patchedFaces[FACE_COUNT][CHUNK_SIZE][CHUNK_SIZE];
+					memcpy(patchedFaces, chunk->faceMasks, sizeof(patchedFaces));
+					std::vector<ChunkVertex> patchedVerts = chunk->verts;
+					bool kept = chunk->keepVerts && mode == MESHING_NAIVE;
+
+					chunk->markFullRemesh();
+					chunk->updateData();
+					errors += memcmp(patchedFaces, chunk->faceMasks, sizeof(patchedFaces)) != 0;
+					if (kept) {
+						errors += patchedVerts.size() != chunk->verts.size() || (!patchedVerts.empty() && memcmp(&patchedVerts[0], &chunk->verts[0], patchedVerts.size() * sizeof(ChunkVertex)) != 0);
+					}
+				}
+				ChunkRenderState::receiveMeshes();
+			}
+		}
+
+		std::cout << "Block edits (" << (mode == MESHING_GREEDY ? "greedy" : "naive") << ", " << EDIT_COUNT << " edits): " << EDIT_COUNT / ms[0] * 1000 << " edits/s patched, "
+			<< EDIT_COUNT / ms[1] * 1000 << " edits/s with full remeshing (" << ms[1] / ms[0] << "x), " << neighborMeshes[0] << " neighbor remeshes for "
+			<< edgeEdits << " edits on chunk edges, " << errors << " errors" << (errors == 0 ? "" : " - PATCHED MESHES ARE WRONG!") << std::endl;
+	}
+
+	for (Chunk* chunk : chunks) {
+		delete chunk;
+	}
+	Chunk::setMeshingMode(previousMode);
+}
+
+void Benchmark::bulkEdits() {
+	BlockId stone = Block::getBlockId("stone");
+	std::mt19937 random = std::mt19937(1234);
+
+	// the same edits go into two areas, block by block into the first and in bulk into the second
+	glm::ivec3 box = glm::ivec3(BULK_BOX_SIZE, WORLD_HEIGHT / 2, BULK_BOX_SIZE);
+	glm::ivec3 perBlockArea = glm::ivec3(BENCHMARK_CHUNK_POS, 0, BENCHMARK_CHUNK_POS);
+	glm::ivec3 bulkArea = perBlockArea + glm::ivec3(2 * BULK_BOX_SIZE, 0, 0);
+	glm::vec3 sphereCenter = glm::vec3(box) * 0.5f;
+	float radiusSquared = BULK_SPHERE_RADIUS * BULK_SPHERE_RADIUS;
+
+	// fill the box
+	double start = getTimeNs();
+	for (int x = 0; x < box.x; x++) {
+		for (int z = 0; z < box.z; z++) {
+			for (int y = 0; y < box.y; y++) {
+				Chunk::addBlock(stone, perBlockArea.x + x, y, perBlockArea.z + z);
+			}
+		}
+	}
+	double perBlockFillMs = (getTimeNs() - start) / 1000000;
+
+	start = getTimeNs();
+	int filled = BlockEdit::fillBox(stone, bulkArea, bulkArea + box - glm::ivec3(1));
+	double bulkFillMs = (getTimeNs() - start) / 1000000;
+
+	// clear a sphere out of it, like an explosion
+	start = getTimeNs();
+	for (int x = 0; x < box.x; x++) {
+		for (int z = 0; z < box.z; z++) {
+			for (int y = 0; y < box.y; y++) {
+				glm::vec3 offset = glm::vec3(x, y, z) + glm::vec3(0.5f) - sphereCenter;
+				if (glm::dot(offset, offset) <= radiusSquared) {
+					Chunk::removeBlock(perBlockArea.x + x, y, perBlockArea.z + z);
+				}
+			}
+		}
+	}
+	double perBlockSphereMs = (getTimeNs() - start) / 1000000;
+
+	start = getTimeNs();
+	int cleared = BlockEdit::fillSphere(BLOCK_AIR, glm::vec3(bulkArea) + sphereCenter, BULK_SPHERE_RADIUS);
+	double bulkSphereMs = (getTimeNs() - start) / 1000000;
+
+	// both areas have to hold the same blocks
+	int errors = 0;
+	{
+		EpochGuard guard;
+		for (int x = 0; x < box.x; x++) {
+			for (int z = 0; z < box.z; z++) {
+				int chunkX, chunkZ, bulkChunkX, bulkChunkZ;
+				Chunk::getChunkPosition(perBlockArea.x + x, perBlockArea.z + z, chunkX, chunkZ);
+				Chunk::getChunkPosition(bulkArea.x + x, bulkArea.z + z, bulkChunkX, bulkChunkZ);
+				Chunk* chunk = Chunk::chunkList.find(Chunk::getChunkIndex(chunkX, chunkZ));
+				Chunk* bulkChunk = Chunk::chunkList.find(Chunk::getChunkIndex(bulkChunkX, bulkChunkZ));
+				for (int y = 0; y < WORLD_HEIGHT; y++) {
+					errors += chunk->getBlock(perBlockArea.x + x - chunkX, y, perBlockArea.z + z - chunkZ) != bulkChunk->getBlock(bulkArea.x + x - bulkChunkX, y, bulkArea.z + z - bulkChunkZ);
+				}
+			}
+		}
+	}
+
+	// paste a cube of random blocks (air included) across chunk edges, and read it back
+	std::vector<BlockId> cube = std::vector<BlockId>(BULK_PASTE_SIZE * BULK_PASTE_SIZE * BULK_PASTE_SIZE);
+	for (BlockId& id : cube) {
+		id = random() % Block::getBlockCount();
+	}
+	glm::ivec3 pasteOrigin = bulkArea + glm::ivec3(CHUNK_SIZE / 2, 1, CHUNK_SIZE / 2);
+	start = getTimeNs();
+	int pasted = BlockEdit::paste(&cube[0], pasteOrigin, glm::ivec3(BULK_PASTE_SIZE), true);
+	double pasteMs = (getTimeNs() - start) / 1000000;
+	{
+		EpochGuard guard;
+		for (int x = 0; x < BULK_PASTE_SIZE; x++) {
+			for (int z = 0; z < BULK_PASTE_SIZE; z++) {
+				int chunkX, chunkZ;
+				Chunk::getChunkPosition(pasteOrigin.x + x, pasteOrigin.z + z, chunkX, chunkZ);
+				Chunk* chunk = Chunk::chunkList.find(Chunk::getChunkIndex(chunkX, chunkZ));
+				for (int y = 0; y < BULK_PASTE_SIZE; y++) {
+					errors += chunk->getBlock(pasteOrigin.x + x - chunkX, pasteOrigin.y + y, pasteOrigin.z + z - chunkZ) != cube[(x * BULK_PASTE_SIZE + z) * BULK_PASTE_SIZE + y];
+				}
+			}
+		}
+	}
+
+	std::cout << "Bulk edits: box of " << filled << " blocks in " << bulkFillMs << " ms (" << perBlockFillMs / bulkFillMs << "x faster than addBlock), sphere of "
+		<< cleared << " blocks in " << bulkSphereMs << " ms (" << perBlockSphereMs / bulkSphereMs << "x faster than removeBlock), paste of "
+		<< pasted << " changed blocks in " << pasteMs << " ms, " << errors << " errors" << (errors == 0 ? "" : " - BULK EDITS ARE WRONG!") << std::endl;
+
+	// the chunks were created by the edits
+	for (glm::ivec3 area : { perBlockArea, bulkArea }) {
+		for (int chunkX = area.x; chunkX < area.x + box.x; chunkX += CHUNK_SIZE) {
+			for (int chunkZ = area.z; chunkZ < area.z + box.z; chunkZ += CHUNK_SIZE) {
+				Chunk::removeChunk(chunkX, chunkZ);
+			}
+		}
+	}
+	Epoch::collect();
+}
+
+void Benchmark::profilerZones() {
+#if PROFILER_ENABLED
+	// an empty zone is all overhead: two clock reads and one ring slot
+	double start = getTimeNs();
+	for (int i = 0; i < PROFILER_ZONE_COUNT; i++) {
+		PROFILE_ZONE("benchmark zone");
+	}
+	double zoneNs = (getTimeNs() - start) / PROFILER_ZONE_COUNT;
+
+	// threads keep recording (and wrapping their rings) while the trace is written, then write it again once they are done, when every
+	// thread's ring is full of its own zones
+	std::atomic<bool> stop(false);
+	std::vector<std::thread> threads;
+	for (int t = 0; t < PROFILER_THREADS; t++) {
+		threads.push_back(std::thread([&stop]() {
+			for (int i = 0; i < PROFILER_BUFFER_EVENTS * 2 || !stop; i++) {
+				PROFILE_ZONE("benchmark thread zone");
+			}
+		}));
+	}
+	bool written = Profiler::writeTrace(PROFILER_TEST_TRACE);
+	stop = true;
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
+
+	start = getTimeNs();
+	written = Profiler::writeTrace(PROFILER_TEST_TRACE) && written;
+	double writeMs = (getTimeNs() - start) / 1000000;
+
+	// every zone is on its own line, each thread (including ones left from earlier runs) should have a full ring of them
+	std::map<int, int> threadZones;
+	int errors = written ? 0 : 1;
+	std::ifstream trace = std::ifstream(PROFILER_TEST_TRACE);
+	std::string line;
+	while (std::getline(trace, line)) {
+		size_t tid = line.find("\"tid\":");
+		if (line.find("\"benchmark thread zone\"") != std::string::npos && tid != std::string::npos) {
+			threadZones[std::atoi(line.c_str() + tid + 6)]++;
+			errors += line.find("\"ph\":\"X\"") == std::string::npos || line.find("\"dur\":") == std::string::npos;
+		}
+	}
+	trace.close();
+	std::filesystem::remove(PROFILER_TEST_TRACE);
+
+	errors += threadZones.size() < PROFILER_THREADS;
+	for (std::pair<const int, int>& zones : threadZones) {
+		errors += zones.second != PROFILER_BUFFER_EVENTS;
+	}
+
+	std::cout << "Profiler: " << zoneNs << " ns per zone, trace of " << PROFILER_THREADS * PROFILER_BUFFER_EVENTS << " zones from " << PROFILER_THREADS << " threads written in " << writeMs
+		<< " ms, " << errors << " errors" << (errors == 0 ? "" : " - PROFILER TRACE IS WRONG!") << std::endl;
+#else
+	std::cout << "Profiler: disabled, zones are compiled out" << std::endl;
+#endif
+}
\ No newline at end of file
@@ -0,0 +1,21 @@
+#pragma once
+
+// micro-benchmarks for engine internals, printed to stdout
+// run from main when RUN_BENCHMARKS is true (needs the blocks registered by loadTextures, none of the benchmarks make opengl calls)
+class Benchmark {
+private:
+	static double getTimeNs();		// returns a monotonic timestamp in nanoseconds
+public:
+	static void runAll();	// runs every benchmark below
+
+	static void faceCulling();	// column bitmask face culling vs. per-block face culling on solid, empty and noisy chunks
+	static void chunkMeshing();		// meshes a large world with 1 up to one worker per hardware thread
+	static void chunkLookup();		// chunk registry vs. std::map lookups with random and spatially coherent positions
+	static void chunkRegistryStress();		// inserts, removes, finds and iterates chunk registry entries from many threads at once, and checks the results
+	static void terrainGeneration();	// generates terrain with scalar and sse2 noise, and checks both give the same blocks as a known checksum for a fixed seed
+	static void regionStorage();	// saves and loads a world through region files, checks the round trip and measures loads with a cold and a warm page cache
+	static void dirtySaving();		// saves a world after editing more and more of its chunks, and measures how long edits wait while the save thread writes
+	static void blockEdits();	// single block edits meshed by patching the faces around them vs. full remeshing, and checks both give the same meshes
+	static void bulkEdits();	// fills a box, clears a sphere and pastes blocks with BlockEdit vs. one addBlock/removeBlock call per block, and checks both give the same blocks
+	static void profilerZones();	// measures the cost of a profiler zone, and checks a trace written while threads record keeps each thread's newest zones
+};
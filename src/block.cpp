@@ -10,66 +10,61 @@
 
 std::map<std::string, glm::ivec2> Block::blockOffsets = std::map<std::string, glm::ivec2>();
 
+// registry starts with only air (id 0), which has no flags and no texture
+std::map<std::string, BlockId> Block::blockIds = { { "air", BLOCK_AIR } };
+std::vector<std::string> Block::blockNames = std::vector<std::string>(1, "air");
+std::vector<unsigned char> Block::blockFlags = std::vector<unsigned char>(1, 0);
+std::vector<glm::ivec2> Block::faceOffsets = std::vector<glm::ivec2>(FACE_COUNT, glm::ivec2(0, 0));
+
 bool Block::spriteLoaded = false;
 int Block::spriteWidth = 0;
 int Block::spriteHeight = 0;
 
 // fill data arrays for a block that's centered at (0, 0, 0)
+// each face is a quad, drawn as triangles (0, 1, 2) and (0, 2, 3) using the shared quad index buffer
 // arranged as:
-//			position				texture coords
-const Vertex Block::TOP_FACE[6] = { 
-			0.5, 0.5, 0.5,			1, 0,
-			0.5, 0.5, -0.5,			1, 1,
-			-0.5, 0.5, -0.5,		0, 1,
-
-			-0.5, 0.5, 0.5,			0, 0,
-			0.5, 0.5, 0.5,			1, 0,
-			-0.5, 0.5, -0.5,		0, 1};
-
-const Vertex Block::BOTTOM_FACE[6] = {
-			-0.5, -0.5, -0.5,		0, 1,
-			0.5, -0.5, -0.5,		1, 1,
-			0.5, -0.5, 0.5,			1, 0,
-
-			-0.5, -0.5, -0.5,		0, 1,
-			0.5, -0.5, 0.5,			1, 0,
-			-0.5, -0.5, 0.5,		0, 0};
-
-const Vertex Block::BACK_FACE[6] = { 
-			0.5, -0.5, 0.5,			1, 0,
-			0.5, 0.5, 0.5,			1, 1,
-			-0.5, 0.5, 0.5,			0, 1,
-
-			-0.5, -0.5, 0.5,		0, 0,
-			0.5, -0.5, 0.5,			1, 0,
-			-0.5, 0.5, 0.5,			0, 1};
-
-const Vertex Block::FRONT_FACE[6] = {
-			-0.5, 0.5, -0.5,		0, 1,
-			0.5, 0.5, -0.5,			1, 1,
-			0.5, -0.5, -0.5,		1, 0,
-
-			-0.5, 0.5, -0.5,		0, 1,
-			0.5, -0.5, -0.5,		1, 0,
-			-0.5, -0.5, -0.5,		0, 0};
-
-const Vertex Block::RIGHT_FACE[6] = {
-			0.5, -0.5, -0.5,		0, 0,
-			0.5, 0.5, -0.5,			0, 1,
-			0.5, 0.5, 0.5,			1, 1,
-
-			0.5, -0.5, 0.5,			1, 0,
-			0.5, -0.5, -0.5,		0, 0,
-			0.5, 0.5, 0.5,			1, 1};
-
-const Vertex Block::LEFT_FACE[6] = {
-			-0.5, 0.5, 0.5,			1, 1,
-			-0.5, 0.5, -0.5,		0, 1,
-			-0.5, -0.5, -0.5,		0, 0,
-
-			-0.5, 0.5, 0.5,			1, 1,
-			-0.5, -0.5, -0.5,		0, 0,
-			-0.5, -0.5, 0.5,		1, 0};
+//			position				texture coords		sprite offset (set when meshing)
+const Vertex Block::TOP_FACE[4] = { 
+			0.5, 0.5, 0.5,			1, 0,				0, 0,
+			0.5, 0.5, -0.5,			1, 1,				0, 0,
+			-0.5, 0.5, -0.5,		0, 1,				0, 0,
+			-0.5, 0.5, 0.5,			0, 0,				0, 0};
+
+const Vertex Block::BOTTOM_FACE[4] = {
+			-0.5, -0.5, -0.5,		0, 1,				0, 0,
+			0.5, -0.5, -0.5,		1, 1,				0, 0,
+			0.5, -0.5, 0.5,			1, 0,				0, 0,
+			-0.5, -0.5, 0.5,		0, 0,				0, 0};
+
+const Vertex Block::BACK_FACE[4] = { 
+			0.5, -0.5, 0.5,			1, 0,				0, 0,
+			0.5, 0.5, 0.5,			1, 1,				0, 0,
+			-0.5, 0.5, 0.5,			0, 1,				0, 0,
+			-0.5, -0.5, 0.5,		0, 0,				0, 0};
+
+const Vertex Block::FRONT_FACE[4] = {
+			-0.5, 0.5, -0.5,		0, 1,				0, 0,
+			0.5, 0.5, -0.5,			1, 1,				0, 0,
+			0.5, -0.5, -0.5,		1, 0,				0, 0,
+			-0.5, -0.5, -0.5,		0, 0,				0, 0};
+
+const Vertex Block::RIGHT_FACE[4] = {
+			0.5, -0.5, -0.5,		0, 0,				0, 0,
+			0.5, 0.5, -0.5,			0, 1,				0, 0,
+			0.5, 0.5, 0.5,			1, 1,				0, 0,
+			0.5, -0.5, 0.5,			1, 0,				0, 0};
+
+const Vertex Block::LEFT_FACE[4] = {
+			-0.5, 0.5, 0.5,			1, 1,				0, 0,
+			-0.5, 0.5, -0.5,		0, 1,				0, 0,
+			-0.5, -0.5, -0.5,		0, 0,				0, 0,
+			-0.5, -0.5, 0.5,		1, 0,				0, 0};
+
+const Vertex* Block::getFaceVertices(int face) {
+	// order must match the FACE_* indices
+	static const Vertex* const FACES[FACE_COUNT] = { TOP_FACE, BOTTOM_FACE, FRONT_FACE, BACK_FACE, RIGHT_FACE, LEFT_FACE };
+	return FACES[face];
+}
 
 void Block::loadSpritesheet() {
 	std::string path = BLOCK_SPRITE_PATH;	// do this so functions c_str can be used
@@ -122,6 +117,9 @@ void Block::bindSpritesheet(unsigned int shaderId) {
 	}
 
 	bindTexture(BLOCK_SPRITE_NAME, shaderId);
+
+	// size of one sprite in texture coordinates, used by the shader to find tiles in the sheet
+	glUniform2f(glGetUniformLocation(shaderId, "spriteUnit"), 1.0f * BLOCK_SPRITE_UNIT / spriteWidth, 1.0f * BLOCK_SPRITE_UNIT / spriteHeight);
 }
 
 int Block::getSpriteWidth() {
@@ -132,29 +130,62 @@ int Block::getSpriteHeight() {
 	return spriteHeight;
 }
 
-Block::Block(std::string name, int x, int y, int z) : name(name), pos(glm::vec3(x, y, z)), exposedFaces(0) {}
+BlockId Block::registerBlock(std::string name, const BlockTexture& texture, unsigned char flags) {
+	// check if the name is already taken
+	if (blockIds.find(name) != blockIds.end()) {
+		std::cerr << "Block \"" << name << "\" has already been registered." << std::endl;
+		return blockIds[name];
+	}
+
+	// make sure there are ids left
+	if (blockNames.size() > UINT16_MAX) {
+		std::cerr << "Cannot register block \"" << name << "\", no block ids left." << std::endl;
+		return BLOCK_AIR;
+	}
+
+	// next id is the number of blocks registered so far
+	BlockId id = blockNames.size();
+	blockIds[name] = id;
+	blockNames.push_back(name);
+	blockFlags.push_back(flags);
+
+	// resolve texture names to spritesheet offsets now, so meshing never looks up names
+	// order must match the FACE_* indices
+	faceOffsets.push_back(getBlockTextureOffset(texture.top));
+	faceOffsets.push_back(getBlockTextureOffset(texture.bottom));
+	faceOffsets.push_back(getBlockTextureOffset(texture.front));
+	faceOffsets.push_back(getBlockTextureOffset(texture.back));
+	faceOffsets.push_back(getBlockTextureOffset(texture.right));
+	faceOffsets.push_back(getBlockTextureOffset(texture.left));
+
+	return id;
+}
+
+BlockId Block::getBlockId(std::string name) {
+	if (blockIds.find(name) == blockIds.end()) {
+		std::cerr << "Block named \"" << name << "\" not registered." << std::endl;
+		return BLOCK_AIR;
+	}
 
-std::string Block::getName() {
-	return name;
+	return blockIds[name];
 }
 
-void Block::setFace(unsigned char bits) {
-	exposedFaces |= bits;
+std::string Block::getBlockName(BlockId id) {
+	return blockNames[id];
 }
 
-void Block::resetFace(unsigned char bits) {
-	exposedFaces &= ~bits;
+int Block::getBlockCount() {
+	return blockNames.size();
 }
 
-void Block::boolFace(unsigned char bits, bool status) {
-	if (status) {
-		setFace(bits);
-	}
-	else {
-		resetFace(bits);
-	}
+bool Block::isOpaque(BlockId id) {
+	return blockFlags[id] & BLOCK_FLAG_OPAQUE;
+}
+
+bool Block::isSolid(BlockId id) {
+	return blockFlags[id] & BLOCK_FLAG_SOLID;
 }
 
-bool Block::getFace(unsigned char bits) {
-	return exposedFaces & bits;
+glm::ivec2 Block::getFaceOffset(BlockId id, int face) {
+	return faceOffsets[id * FACE_COUNT + face];
 }
\ No newline at end of file
@@ -2,8 +2,19 @@
 
 #include <string>
 #include <map>
+#include <vector>
+#include <cstdint>
 #include <glm/glm.hpp>
 
+// face indices, used to index per-face arrays (BIT_FACE_X == 1 << FACE_X)
+#define FACE_TOP 0
+#define FACE_BOTTOM 1
+#define FACE_FRONT 2
+#define FACE_BACK 3
+#define FACE_RIGHT 4
+#define FACE_LEFT 5
+#define FACE_COUNT 6
+
 #define BIT_FACE_TOP 1
 #define BIT_FACE_BOTTOM 2
 #define BIT_FACE_FRONT 4
@@ -16,27 +27,40 @@
 #define BLOCK_SPRITE_NAME "block sprites"
 #define BLOCK_SPRITE_PATH "assetts/textures/block_sprite.png"
 
+// block property flags
+#define BLOCK_FLAG_OPAQUE 1		// hides the faces of neighboring blocks
+#define BLOCK_FLAG_SOLID 2		// can't be moved through
+
+#define BLOCK_AIR 0		// id of the empty block, always registered
+
+typedef uint16_t BlockId;	// dense numeric id of a block type, assigned by Block::registerBlock
+
 // forward declarations
 struct Vertex;
 struct BlockTexture;
 
+// blocks are not stored as objects, chunks keep their ids in palette-compressed storage (see block_storage.h)
+// this class is the block registry: it assigns ids and holds per-id properties in flat arrays indexed by id
 class Block {
 private:
-	glm::ivec3 pos;		// position of left, bottom, front corner (lowest x, y, z) along integer grid
-	unsigned char exposedFaces;		// 1 byte bitmask for which faces are exposed
-	std::string name;	// name of this block
-
 	static bool spriteLoaded;	// whether or not the spritesheet has been loaded
 	static int spriteWidth, spriteHeight;	// dimensions of sprite sheet
 	static std::map<std::string, glm::ivec2> blockOffsets;		// maps texture names to their offsets in the block spritesheet
+
+	static std::map<std::string, BlockId> blockIds;		// maps block names to ids (only used when registering/looking up by name)
+	static std::vector<std::string> blockNames;		// name of each id
+	static std::vector<unsigned char> blockFlags;	// BLOCK_FLAG_* bits of each id
+	static std::vector<glm::ivec2> faceOffsets;		// spritesheet offset of each face of each id, indexed by (id * FACE_COUNT + face)
 public:
-	// vertex arrays which contain data for each face
-	static const Vertex TOP_FACE[6];
-	static const Vertex BOTTOM_FACE[6];
-	static const Vertex FRONT_FACE[6];
-	static const Vertex BACK_FACE[6];
-	static const Vertex RIGHT_FACE[6];
-	static const Vertex LEFT_FACE[6];
+	// vertex arrays which contain the 4 corners of each face
+	static const Vertex TOP_FACE[4];
+	static const Vertex BOTTOM_FACE[4];
+	static const Vertex FRONT_FACE[4];
+	static const Vertex BACK_FACE[4];
+	static const Vertex RIGHT_FACE[4];
+	static const Vertex LEFT_FACE[4];
+
+	static const Vertex* getFaceVertices(int face);		// returns the vertex array of the given face (FACE_*)
 
 	static void addBlockTextureOffset(std::string name, int uOffset, int vOffset);	// add a block texture name along with its offset in the spritesheet
 	static glm::ivec2 getBlockTextureOffset(std::string name);	// returns the right offset from the map
@@ -45,12 +69,12 @@ public:
 	static int getSpriteWidth();	// returns the width of the spritesheet
 	static int getSpriteHeight();	// returns the height of the spritesheet
 
-	Block(std::string name, int x, int y, int z);		// position set to (x, y, z)
-
-	std::string getName();		// returns the name of this block
-
-	void setFace(unsigned char bits);		// sets which faces are exposed (e.g. setFaces(BIT_FACE_TOP | BIT_FACE_FRONT))
-	void resetFace(unsigned char bits);		// sets which faces are not exposed (see example above)
-	void boolFace(unsigned char bits, bool status);		// sets the given faces based on status
-	bool getFace(unsigned char bits);		// gets which faces are exposed (if multiple bits supplied, returns true only if all given faces are exposed)
+	// registers a block type and returns its new id, texture offsets must be added first
+	static BlockId registerBlock(std::string name, const BlockTexture& texture, unsigned char flags = BLOCK_FLAG_OPAQUE | BLOCK_FLAG_SOLID);
+	static BlockId getBlockId(std::string name);	// returns the id of the given block name (BLOCK_AIR if not registered)
+	static std::string getBlockName(BlockId id);	// returns the name of the given id
+	static int getBlockCount();		// returns the number of registered ids (including air)
+	static bool isOpaque(BlockId id);	// whether or not the given block hides neighboring faces
+	static bool isSolid(BlockId id);	// whether or not the given block can be moved through
+	static glm::ivec2 getFaceOffset(BlockId id, int face);		// returns the spritesheet offset of the given face (FACE_*) of the given block
 };
\ No newline at end of file
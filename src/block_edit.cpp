@@ -0,0 +1,165 @@
+#include <algorithm>
+#include <cmath>
+
+#include "block_edit.h"
+#include "chunk.h"
+#include "epoch.h"
+
+// bits minY to maxY (inclusive) of a column mask, both in [0, WORLD_HEIGHT)
+static uint32_t getSpanBits(int minY, int maxY) {
+	return (0xFFFFFFFFu >> (31 - maxY)) & (0xFFFFFFFFu << minY);
+}
+
+Chunk* BlockEdit::getChunk(int chunkX, int chunkZ, bool create) {
+	ChunkKey key = Chunk::getChunkIndex(chunkX, chunkZ);
+	Chunk* chunk = Chunk::chunkList.find(key);
+	if (chunk != nullptr || !create) {
+		return chunk;
+	}
+
+	// if another thread added the chunk first, that one is used
+	bool inserted;
+	return Chunk::create(glm::ivec2(chunkX, chunkZ), inserted);
+}
+
+int BlockEdit::fillColumns(BlockId id, int minX, int minZ, int maxX, int maxZ, const ColumnSpan& span) {
+	int minChunkX, minChunkZ, maxChunkX, maxChunkZ;
+	Chunk::getChunkPosition(minX, minZ, minChunkX, minChunkZ);
+	Chunk::getChunkPosition(maxX, maxZ, maxChunkX, maxChunkZ);
+
+	int changed = 0;
+	EpochGuard guard;
+	for (int chunkX = minChunkX; chunkX <= maxChunkX; chunkX += CHUNK_SIZE) {
+		for (int chunkZ = minChunkZ; chunkZ <= maxChunkZ; chunkZ += CHUNK_SIZE) {
+			// cells of this chunk inside the edit, one mask per column
+			uint32_t cells[CHUNK_SIZE][CHUNK_SIZE];
+			bool empty = true;
+			for (int x = 0; x < CHUNK_SIZE; x++) {
+				for (int z = 0; z < CHUNK_SIZE; z++) {
+					cells[x][z] = 0;
+
+					int minY, maxY;
+					int globalX = chunkX + x;
+					int globalZ = chunkZ + z;
+					if (globalX < minX || globalX > maxX || globalZ < minZ || globalZ > maxZ || !span(globalX, globalZ, minY, maxY)) {
+						continue;
+					}
+
+					minY = std::max(minY, 0);
+					maxY = std::min(maxY, WORLD_HEIGHT - 1);
+					if (minY <= maxY) {
+						cells[x][z] = getSpanBits(minY, maxY);
+						empty = false;
+					}
+				}
+			}
+
+			if (empty) {
+				continue;
+			}
+
+			Chunk* chunk = getChunk(chunkX, chunkZ, id != BLOCK_AIR);
+			if (chunk != nullptr) {
+				changed += chunk->fillBlocks(id, cells);
+			}
+		}
+	}
+
+	return changed;
+}
+
+int BlockEdit::fillBox(BlockId id, glm::ivec3 min, glm::ivec3 max) {
+	return fillColumns(id, min.x, min.z, max.x, max.z, [min, max](int, int, int& minY, int& maxY) {
+		minY = min.y;
+		maxY = max.y;
+		return true;
+	});
+}
+
+int BlockEdit::fillSphere(BlockId id, glm::vec3 center, float radius) {
+	if (radius < 0) {
+		return 0;
+	}
+
+	// each column is filled between the heights where its center line enters and leaves the sphere
+	int minX = (int) std::floor(center.x - radius);
+	int minZ = (int) std::floor(center.z - radius);
+	int maxX = (int) std::floor(center.x + radius);
+	int maxZ = (int) std::floor(center.z + radius);
+	return fillColumns(id, minX, minZ, maxX, maxZ, [center, radius](int x, int z, int& minY, int& maxY) {
+		float dx = x + 0.5f - center.x;
+		float dz = z + 0.5f - center.z;
+		float heightSquared = radius * radius - dx * dx - dz * dz;
+		if (heightSquared < 0) {
+			return false;
+		}
+
+		// block y is inside if its center (y + 0.5) is within the half height of center.y
+		float height = std::sqrt(heightSquared);
+		minY = (int) std::ceil(center.y - height - 0.5f);
+		maxY = (int) std::floor(center.y + height - 0.5f);
+		return minY <= maxY;
+	});
+}
+
+int BlockEdit::fillColumn(BlockId id, int x, int z, int minY, int maxY) {
+	return fillBox(id, glm::ivec3(x, minY, z), glm::ivec3(x, maxY, z));
+}
+
+int BlockEdit::paste(const BlockId* ids, glm::ivec3 origin, glm::ivec3 size, bool pasteAir) {
+	if (size.x <= 0 || size.y <= 0 || size.z <= 0) {
+		return 0;
+	}
+
+	int minChunkX, minChunkZ, maxChunkX, maxChunkZ;
+	Chunk::getChunkPosition(origin.x, origin.z, minChunkX, minChunkZ);
+	Chunk::getChunkPosition(origin.x + size.x - 1, origin.z + size.z - 1, maxChunkX, maxChunkZ);
+	int minY = std::max(origin.y, 0);
+	int maxY = std::min(origin.y + size.y - 1, WORLD_HEIGHT - 1);
+
+	int changed = 0;
+	BlockId chunkIds[CHUNK_VOLUME];
+	EpochGuard guard;
+	for (int chunkX = minChunkX; chunkX <= maxChunkX; chunkX += CHUNK_SIZE) {
+		for (int chunkZ = minChunkZ; chunkZ <= maxChunkZ; chunkZ += CHUNK_SIZE) {
+			// ids of this chunk's cells inside the pasted array, rearranged into the chunk's block index order
+			uint32_t cells[CHUNK_SIZE][CHUNK_SIZE];
+			bool empty = true;
+			bool solid = false;		// whether or not anything but air is pasted into this chunk
+			for (int x = 0; x < CHUNK_SIZE; x++) {
+				for (int z = 0; z < CHUNK_SIZE; z++) {
+					cells[x][z] = 0;
+
+					int pasteX = chunkX + x - origin.x;
+					int pasteZ = chunkZ + z - origin.z;
+					if (pasteX < 0 || pasteX >= size.x || pasteZ < 0 || pasteZ >= size.z) {
+						continue;
+					}
+
+					int column = (pasteX * size.z + pasteZ) * size.y;
+					for (int y = minY; y <= maxY; y++) {
+						BlockId id = ids[column + y - origin.y];
+						if (id == BLOCK_AIR && !pasteAir) {
+							continue;
+						}
+						chunkIds[Chunk::getBlockIndex(x, y, z)] = id;
+						cells[x][z] |= 1u << y;
+						empty = false;
+						solid = solid || id != BLOCK_AIR;
+					}
+				}
+			}
+
+			if (empty) {
+				continue;
+			}
+
+			Chunk* chunk = getChunk(chunkX, chunkZ, solid);
+			if (chunk != nullptr) {
+				changed += chunk->pasteBlocks(chunkIds, cells);
+			}
+		}
+	}
+
+	return changed;
+}
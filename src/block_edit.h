@@ -0,0 +1,28 @@
+#pragma once
+
+#include <functional>
+
+#include <glm/glm.hpp>
+
+#include "block.h"
+
+// forward declarations
+class Chunk;
+
+// edits many blocks at once: the cells of each chunk are collected first and written with one lock per chunk,
+// and each touched chunk is marked for remeshing and saving once (see Chunk::fillBlocks)
+// filling with BLOCK_AIR clears blocks, other blocks create the chunks which don't exist yet (like Chunk::addBlock)
+// positions are in global coords, anything outside the world's height is cut off, and every edit returns the number of blocks changed
+// like Chunk::addBlock, the touched chunks aren't meshed here (see Chunk::updateChunksByNeighbor)
+class BlockEdit {
+private:
+	typedef std::function<bool(int x, int z, int& minY, int& maxY)> ColumnSpan;	// sets the y range [minY, maxY] to fill in global column (x, z), false if there is none
+
+	static Chunk* getChunk(int chunkX, int chunkZ, bool create);	// returns the chunk at (chunkX, chunkZ), creating it if it doesn't exist and create is set (nullptr otherwise), the caller holds an EpochGuard
+	static int fillColumns(BlockId id, int minX, int minZ, int maxX, int maxZ, const ColumnSpan& span);		// fills the span of every column from (minX, minZ) to (maxX, maxZ), inclusive
+public:
+	static int fillBox(BlockId id, glm::ivec3 min, glm::ivec3 max);		// fills every position from min to max (inclusive)
+	static int fillSphere(BlockId id, glm::vec3 center, float radius);	// fills every position whose block center is within radius of center
+	static int fillColumn(BlockId id, int x, int z, int minY, int maxY);	// fills positions minY to maxY (inclusive) of column (x, z)
+	static int paste(const BlockId* ids, glm::ivec3 origin, glm::ivec3 size, bool pasteAir);	// copies size.x * size.y * size.z ids to origin, indexed (x * size.z + z) * size.y + y like chunks, air only clears blocks if pasteAir is set
+};
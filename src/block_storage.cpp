@@ -0,0 +1,293 @@
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+
+#include "block_storage.h"
+
+BlockStorage::BlockStorage(int size) : palette(1, BLOCK_AIR), paletteCounts(1, size), size(size), bitsPerIndex(STORAGE_MIN_BITS) {
+	// every position starts at palette index 0 (air), which is all zero bits
+	data = std::vector<uint64_t>((size * bitsPerIndex + 63) / 64, 0);
+}
+
+int BlockStorage::getPaletteIndex(int index) {
+	// position of the index within the data words
+	int bit = index * bitsPerIndex;
+	uint64_t mask = (1ULL << bitsPerIndex) - 1;
+
+	return (data[bit >> 6] >> (bit & 63)) & mask;
+}
+
+void BlockStorage::setPaletteIndex(int index, int paletteIndex) {
+	int bit = index * bitsPerIndex;
+	uint64_t mask = (1ULL << bitsPerIndex) - 1;
+
+	// clear old bits and write new ones
+	uint64_t& word = data[bit >> 6];
+	word &= ~(mask << (bit & 63));
+	word |= ((uint64_t) paletteIndex & mask) << (bit & 63);
+}
+
+int BlockStorage::findOrAddPaletteEntry(BlockId id) {
+	// check if the id is already in the palette, and remember the first unused entry
+	int unused = -1;
+	for (int i = 1; i < (int) palette.size(); i++) {
+		if (paletteCounts[i] == 0) {
+			if (unused == -1) {
+				unused = i;
+			}
+		}
+		else if (palette[i] == id) {
+			return i;
+		}
+	}
+
+	// reuse an unused entry if possible
+	if (unused != -1) {
+		palette[unused] = id;
+		return unused;
+	}
+
+	// add a new entry, widening the indices if they can't fit it
+	if (palette.size() >= (1U << bitsPerIndex)) {
+		if (bitsPerIndex >= STORAGE_MAX_BITS) {
+			std::cerr << "Block storage palette is full, cannot add block id " << id << "." << std::endl;
+			return 0;
+		}
+
+		widen(bitsPerIndex * 2);
+	}
+
+	palette.push_back(id);
+	paletteCounts.push_back(0);
+
+	return palette.size() - 1;
+}
+
+void BlockStorage::widen(int newBits) {
+	// read all indices using the old width
+	std::vector<int> indices = std::vector<int>(size);
+	for (int i = 0; i < size; i++) {
+		indices[i] = getPaletteIndex(i);
+	}
+
+	// repack them using the new width
+	bitsPerIndex = newBits;
+	data.assign((size * bitsPerIndex + 63) / 64, 0);
+	for (int i = 0; i < size; i++) {
+		setPaletteIndex(i, indices[i]);
+	}
+}
+
+BlockId BlockStorage::get(int index) {
+	return palette[getPaletteIndex(index)];
+}
+
+void BlockStorage::set(int index, BlockId id) {
+	// air always maps to 0, other ids are found in (or added to) the palette
+	int newIndex = (id == BLOCK_AIR) ? 0 : findOrAddPaletteEntry(id);
+	int oldIndex = getPaletteIndex(index);
+
+	if (newIndex == oldIndex) {
+		return;
+	}
+
+	// update the reference counts, an entry whose count drops to 0 becomes reusable
+	paletteCounts[oldIndex]--;
+	paletteCounts[newIndex]++;
+
+	setPaletteIndex(index, newIndex);
+}
+
+// number of set bits
+static int countBits(uint64_t bits) {
+	bits = bits - ((bits >> 1) & 0x5555555555555555ULL);
+	bits = (bits & 0x3333333333333333ULL) + ((bits >> 2) & 0x3333333333333333ULL);
+	bits = (bits + (bits >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+	return (int) ((bits * 0x0101010101010101ULL) >> 56);
+}
+
+uint64_t BlockStorage::getNonZeroSlots(uint64_t word) {
+	// or every bit of a slot down into its lowest bit
+	for (int shift = 1; shift < bitsPerIndex; shift <<= 1) {
+		word |= word >> shift;
+	}
+	return word & (~0ULL / ((1ULL << bitsPerIndex) - 1));
+}
+
+int BlockStorage::fill(int begin, int end, BlockId id) {
+	int newIndex = (id == BLOCK_AIR) ? 0 : findOrAddPaletteEntry(id);
+
+	// large palettes are counted position by position, small ones a word at a time
+	int changed = 0;
+	if (palette.size() > STORAGE_FILL_PALETTE) {
+		for (int i = begin; i < end; i++) {
+			int oldIndex = getPaletteIndex(i);
+			if (oldIndex != newIndex) {
+				paletteCounts[oldIndex]--;
+				setPaletteIndex(i, newIndex);
+				changed++;
+			}
+		}
+		paletteCounts[newIndex] += changed;
+		return changed;
+	}
+
+	// a word with every slot set to 1, multiplying it by an index repeats the index in every slot
+	uint64_t lowBits = ~0ULL / ((1ULL << bitsPerIndex) - 1);
+	uint64_t newWord = lowBits * newIndex;
+	for (int bit = begin * bitsPerIndex; bit < end * bitsPerIndex; ) {
+		// slots of the range in this word
+		int wordBit = bit & 63;
+		int rangeBits = std::min(64 - wordBit, end * bitsPerIndex - bit);
+		uint64_t range = ((rangeBits == 64) ? ~0ULL : (1ULL << rangeBits) - 1) << wordBit;
+		uint64_t& word = data[bit >> 6];
+		bit += rangeBits;
+
+		uint64_t differs = getNonZeroSlots((word ^ newWord) & range);
+		if (differs == 0) {
+			continue;
+		}
+
+		// the replaced indices lose their references
+		for (int i = 0; i < (int) palette.size(); i++) {
+			if (i != newIndex && paletteCounts[i] != 0) {
+				paletteCounts[i] -= countBits(~getNonZeroSlots((word ^ (lowBits * i)) & range) & lowBits & range);
+			}
+		}
+		changed += countBits(differs);
+		word = (word & ~range) | (newWord & range);
+	}
+	paletteCounts[newIndex] += changed;
+
+	return changed;
+}
+
+void BlockStorage::setAll(const BlockId* ids) {
+	// build a fresh palette from the ids, remembering each position's palette index
+	palette.assign(1, BLOCK_AIR);
+	paletteCounts.assign(1, 0);
+	std::vector<int> indices = std::vector<int>(size);
+	BlockId lastId = BLOCK_AIR;	// runs of the same id are common, so the last lookup is cached
+	int lastIndex = 0;
+	for (int i = 0; i < size; i++) {
+		if (ids[i] != lastId) {
+			lastId = ids[i];
+			lastIndex = 0;
+			if (lastId != BLOCK_AIR) {
+				lastIndex = std::find(palette.begin() + 1, palette.end(), lastId) - palette.begin();
+				if (lastIndex == (int) palette.size()) {
+					palette.push_back(lastId);
+					paletteCounts.push_back(0);
+				}
+			}
+		}
+
+		indices[i] = lastIndex;
+		paletteCounts[lastIndex]++;
+	}
+
+	// pick the narrowest width which fits the palette
+	int newBits = STORAGE_MIN_BITS;
+	while (palette.size() > (1U << newBits)) {
+		if (newBits >= STORAGE_MAX_BITS) {
+			std::cerr << "Block storage palette is full, cannot set " << palette.size() << " different block ids." << std::endl;
+			return;
+		}
+		newBits *= 2;
+	}
+
+	bitsPerIndex = newBits;
+	data.assign((size * bitsPerIndex + 63) / 64, 0);
+	for (int i = 0; i < size; i++) {
+		setPaletteIndex(i, indices[i]);
+	}
+}
+
+void BlockStorage::getAll(BlockId* ids) {
+	for (int i = 0; i < size; i++) {
+		ids[i] = palette[getPaletteIndex(i)];
+	}
+}
+
+void BlockStorage::serialize(std::vector<uint8_t>& out) {
+	size_t start = out.size();
+	size_t paletteBytes = 4 + palette.size() * sizeof(BlockId);
+	size_t headerBytes = (paletteBytes + 7) / 8 * 8;
+	out.resize(start + headerBytes + data.size() * sizeof(uint64_t), 0);
+
+	uint8_t* bytes = out.data() + start;
+	uint16_t paletteSize = palette.size();
+	memcpy(bytes, &paletteSize, sizeof(paletteSize));
+	bytes[2] = bitsPerIndex;
+	memcpy(bytes + 4, palette.data(), palette.size() * sizeof(BlockId));
+	memcpy(bytes + headerBytes, data.data(), data.size() * sizeof(uint64_t));
+}
+
+bool BlockStorage::deserialize(const uint8_t* bytes, size_t length) {
+	if (length < 4) {
+		return false;
+	}
+
+	// check the header before anything is changed
+	uint16_t paletteSize;
+	memcpy(&paletteSize, bytes, sizeof(paletteSize));
+	int newBits = bytes[2];
+	size_t headerBytes = (4 + paletteSize * sizeof(BlockId) + 7) / 8 * 8;
+	size_t wordCount = ((size_t) size * newBits + 63) / 64;
+	if (paletteSize == 0 || (newBits & (newBits - 1)) != 0 || newBits < STORAGE_MIN_BITS || newBits > STORAGE_MAX_BITS ||
+		paletteSize > (1U << newBits) || length != headerBytes + wordCount * sizeof(uint64_t)) {
+		return false;
+	}
+
+	std::vector<BlockId> newPalette = std::vector<BlockId>(paletteSize);
+	memcpy(newPalette.data(), bytes + 4, paletteSize * sizeof(BlockId));
+	if (newPalette[0] != BLOCK_AIR) {
+		return false;
+	}
+
+	std::vector<uint64_t> newData = std::vector<uint64_t>(wordCount);
+	memcpy(newData.data(), bytes + headerBytes, wordCount * sizeof(uint64_t));
+
+	// every index has to point into the palette, and the reference counts are rebuilt while checking
+	uint64_t mask = (1ULL << newBits) - 1;
+	std::vector<int> newCounts = std::vector<int>(paletteSize, 0);
+	for (int i = 0; i < size; i++) {
+		size_t bit = (size_t) i * newBits;
+		int index = (newData[bit >> 6] >> (bit & 63)) & mask;
+		if (index >= paletteSize) {
+			return false;
+		}
+		newCounts[index]++;
+	}
+
+	palette = std::move(newPalette);
+	paletteCounts = std::move(newCounts);
+	data = std::move(newData);
+	bitsPerIndex = newBits;
+
+	return true;
+}
+
+bool BlockStorage::isEmpty(int index) {
+	return getPaletteIndex(index) == 0;
+}
+
+int BlockStorage::getSize() {
+	return size;
+}
+
+int BlockStorage::getPaletteSize() {
+	return palette.size();
+}
+
+int BlockStorage::getBitsPerIndex() {
+	return bitsPerIndex;
+}
+
+size_t BlockStorage::getMemoryUsage() {
+	size_t bytes = data.capacity() * sizeof(uint64_t);
+	bytes += paletteCounts.capacity() * sizeof(int);
+	bytes += palette.capacity() * sizeof(BlockId);
+
+	return bytes;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include "block.h"
+
+#define STORAGE_MIN_BITS 1		// smallest width of a packed palette index
+#define STORAGE_MAX_BITS 16		// largest width of a packed palette index
+#define STORAGE_FILL_PALETTE 16		// fill handles a word at a time for palettes up to this size, larger ones position by position
+
+// palette-compressed storage for the blocks of a chunk
+// each position holds a small index into a palette of block ids, and the indices are bit-packed into 64-bit words
+// the index width starts at 1 bit and doubles (1, 2, 4, 8, 16) whenever the palette outgrows it
+// palette index 0 is always air (BLOCK_AIR)
+// serialized form (little-endian): palette size (uint16), bits per index (uint8), 0 (uint8), palette ids (uint16 each),
+// zero padding up to a multiple of 8 bytes, packed index words (uint64 each)
+class BlockStorage {
+private:
+	std::vector<BlockId> palette;	// block ids used in this storage, entries whose count drops to 0 get reused
+	std::vector<int> paletteCounts;		// number of positions which reference each palette entry
+	std::vector<uint64_t> data;		// bit-packed palette indices of all positions
+	int size;		// number of positions in this storage
+	int bitsPerIndex;		// width of each packed index (always a power of 2 so indices never straddle words)
+
+	int getPaletteIndex(int index);		// returns the packed palette index stored at the given position
+	void setPaletteIndex(int index, int paletteIndex);		// writes a palette index to the given position
+	int findOrAddPaletteEntry(BlockId id);	// returns the palette index of the given id, adding it if needed
+	void widen(int newBits);	// repacks the data so each index is newBits wide
+	uint64_t getNonZeroSlots(uint64_t word);	// returns the lowest bit of each index slot of word which isn't 0
+public:
+	BlockStorage(int size);		// all positions start as air
+
+	BlockId get(int index);		// returns the id of the block at the given position, BLOCK_AIR if there is none
+	void set(int index, BlockId id);		// sets the block at the given position
+	int fill(int begin, int end, BlockId id);	// sets positions begin to end (exclusive) with one palette lookup, returns the number of positions which changed
+	void setAll(const BlockId* ids);	// replaces every position with the given ids (getSize() of them), building the palette in one pass
+	void getAll(BlockId* ids);		// writes the ids of every position (getSize() of them)
+
+	void serialize(std::vector<uint8_t>& out);	// appends the palette and packed indices to out (see deserialize)
+	bool deserialize(const uint8_t* bytes, size_t length);		// replaces this storage with serialized data of the same size, false (and unchanged) if it is invalid
+	bool isEmpty(int index);	// whether or not the given position is air
+
+	int getSize();		// returns the number of positions
+	int getPaletteSize();	// returns the number of palette entries (including unused ones)
+	int getBitsPerIndex();	// returns the current width of each packed index
+	size_t getMemoryUsage();	// returns the number of heap bytes used by this storage (excluding the object itself)
+};
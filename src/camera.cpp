@@ -13,7 +13,38 @@ Camera* Camera::getActiveCam() {
 	return activeCam;
 }
 
-Camera::Camera(glm::vec3 pos, float pitch, float yaw, float fov) : pos(pos), pitch(pitch), yaw(yaw), fov(fov) {}
+Frustum::Frustum(const glm::mat4& matrix) {
+	// each plane is the last row of the matrix plus or minus one of the other rows (glm is column-major, so row i = matrix[...][i])
+	glm::vec4 rows[4];
+	for (int i = 0; i < 4; i++) {
+		rows[i] = glm::vec4(matrix[0][i], matrix[1][i], matrix[2][i], matrix[3][i]);
+	}
+
+	planes[0] = rows[3] + rows[0];	// left
+	planes[1] = rows[3] - rows[0];	// right
+	planes[2] = rows[3] + rows[1];	// bottom
+	planes[3] = rows[3] - rows[1];	// top
+	planes[4] = rows[3] + rows[2];	// near
+	planes[5] = rows[3] - rows[2];	// far
+}
+
+bool Frustum::intersectsBox(glm::vec3 min, glm::vec3 max) {
+	for (int i = 0; i < 6; i++) {
+		glm::vec4& plane = planes[i];
+
+		// corner of the box furthest along the plane's normal
+		glm::vec3 corner = glm::vec3(plane.x >= 0 ? max.x : min.x, plane.y >= 0 ? max.y : min.y, plane.z >= 0 ? max.z : min.z);
+
+		// if even that corner is behind the plane, the whole box is outside
+		if (glm::dot(glm::vec3(plane), corner) + plane.w < 0) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+Camera::Camera(glm::vec3 pos, float pitch, float yaw, float fov, float viewDistance) : pos(pos), pitch(pitch), yaw(yaw), fov(fov), viewDistance(viewDistance) {}
 
 void Camera::activate() {
 	activeCam = this;
@@ -28,11 +59,23 @@ glm::mat4 Camera::getMatrix() {
 	float vertFov = 2 * glm::atan(glm::tan(glm::radians(fov) / 2) / ASPECT_RATIO);
 
 	// projection matrix
-	glm::mat4 projection = glm::perspective(vertFov, ASPECT_RATIO, 0.1f, 100.0f);
+	glm::mat4 projection = glm::perspective(vertFov, ASPECT_RATIO, 0.1f, viewDistance);
 
 	return projection * view;
 }
 
+Camera Camera::interpolate(Camera& next, float alpha) {
+	Camera result = next;
+	result.pos = glm::mix(pos, next.pos, alpha);
+	result.setPitch(glm::mix(pitch, next.pitch, alpha));
+
+	// turn the short way around, yaw wraps at 360
+	float yawChange = glm::mod(next.yaw - yaw + 540.0f, 360.0f) - 180.0f;
+	result.setYaw(yaw + yawChange * alpha);
+
+	return result;
+}
+
 void Camera::translate(glm::vec3 translation) {
 	pos += translation;
 }
@@ -91,6 +134,10 @@ void Camera::setFov(float fov) {
 	}
 }
 
+void Camera::setViewDistance(float distance) {
+	viewDistance = distance;
+}
+
 glm::vec3 Camera::getPosition() {
 	return pos;
 }
@@ -130,4 +177,29 @@ float Camera::getPitch() {
 
 float Camera::getFov() {
 	return fov;
+}
+
+float Camera::getViewDistance() {
+	return viewDistance;
+}
+
+CameraBuffer::CameraBuffer(const CameraState& initial) : spare(2), writeSlot(0), readSlot(1) {
+	for (int i = 0; i < 3; i++) {
+		states[i] = initial;
+	}
+}
+
+void CameraBuffer::publish(const CameraState& state) {
+	states[writeSlot] = state;
+
+	// release so the reader sees the whole state once it takes the slot, acquire so the old spare is done being read before it's overwritten
+	writeSlot = spare.exchange(writeSlot | FRESH, std::memory_order_acq_rel) & ~FRESH;
+}
+
+CameraState& CameraBuffer::read() {
+	// only swap when the spare is newer than what the reader has, otherwise the reader would get an older state back
+	if (spare.load(std::memory_order_relaxed) & FRESH) {
+		readSlot = spare.exchange(readSlot, std::memory_order_acq_rel) & ~FRESH;
+	}
+	return states[readSlot];
 }
\ No newline at end of file
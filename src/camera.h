@@ -1,7 +1,20 @@
 #pragma once
 
+#include <atomic>
+#include <cstdint>
+
 #include <glm/glm.hpp>
 
+// view frustum of a camera matrix, used to skip drawing things which are off-screen
+class Frustum {
+private:
+	glm::vec4 planes[6];	// (normal, distance) of the left, right, bottom, top, near and far planes, normals point inwards
+public:
+	Frustum(const glm::mat4& matrix);	// extracts the planes from a combined view and projection matrix
+
+	bool intersectsBox(glm::vec3 min, glm::vec3 max);	// whether or not the axis-aligned box from min to max is at least partially inside
+};
+
 class Camera {
 private:
 	static Camera* activeCam;	// the camera which is currently outputting to the window
@@ -9,15 +22,17 @@ private:
 	glm::vec3 pos;		// position and forward direction of camera
 	float pitch, yaw;	// rotation of camera (degrees), ranges: pitch: [-89, 89], yaw: [0, 360)
 	float fov;		// this is the horizontal FOV, not the vertical! range: [30, 150]
+	float viewDistance;		// distance to the far plane
 public:
 	static const float ASPECT_RATIO;
 
 	static Camera* getActiveCam();	// return a pointer to the currently active camera
 
-	Camera(glm::vec3 pos = glm::vec3(0, 0, 0), float pitch = 0.0f, float yaw = 0.0f, float fov = 90.0f);	// default camera is at position (0, 0, 0), facing towards -z, with 90 degree fov
+	Camera(glm::vec3 pos = glm::vec3(0, 0, 0), float pitch = 0.0f, float yaw = 0.0f, float fov = 90.0f, float viewDistance = 100.0f);	// default camera is at position (0, 0, 0), facing towards -z, with 90 degree fov
 	
 	void activate();		// select this camera for outputting to the screen
 	glm::mat4 getMatrix();	// returns the combined view and projection matrices of this camera
+	Camera interpolate(Camera& next, float alpha);		// returns a copy of this camera moved and turned alpha (0 to 1) of the way towards next
 	
 	void translate(glm::vec3 translation);		// translate the camera by the given vector
 	void moveTo(glm::vec3 newPos);		// teleports the camera to newPos
@@ -26,6 +41,7 @@ public:
 	void setYaw(float angle);		// set the yaw to the given angle (0 = towards negative z, positive = counterclockwise)
 	void setPitch(float angle);		// set the pitch to the given angle (positive = up)
 	void setFov(float fov);		// set the horizontal fov
+	void setViewDistance(float distance);	// set the distance to the far plane
 	
 	// getters
 	glm::vec3 getPosition();
@@ -39,4 +55,35 @@ public:
 	float getYaw();
 	float getPitch();
 	float getFov();
+	float getViewDistance();
+};
+
+// the game thread's camera as of the end of a game tick
+struct CameraState {
+	Camera previous;	// camera at the end of the tick before, the drawn camera moves from here to current over the next tick
+	Camera current;		// camera at the end of the tick
+	uint64_t tick;		// number of the tick
+	double tickTime;	// when the tick was due (glfwGetTime)
+	double inputTime;	// when the newest input event the tick applied was captured, 0 if it had none
+
+	CameraState() : tick(0), tickTime(0), inputTime(0) {}
+};
+
+// hands the game thread's camera state to the render thread without locks
+// the writer and the reader each own one of three slots and the third one is passed between them: the writer fills its slot and swaps
+// it with the spare, the reader swaps its slot with the spare whenever that holds a newer state, so both always have a complete state
+// the other side doesn't touch and neither ever waits
+class CameraBuffer {
+private:
+	static const int FRESH = 4;		// flag in spare: the spare slot holds a state the reader hasn't taken yet
+
+	CameraState states[3];
+	alignas(64) std::atomic<int> spare;		// index of the slot neither side owns, plus FRESH
+	alignas(64) int writeSlot;		// slot the writer fills (writer only)
+	alignas(64) int readSlot;		// slot with the latest state the reader took (reader only)
+public:
+	CameraBuffer(const CameraState& initial);	// every slot starts as initial
+
+	void publish(const CameraState& state);		// makes state the latest one (game thread only)
+	CameraState& read();	// returns the latest published state, valid until the next read (render thread only)
 };
\ No newline at end of file
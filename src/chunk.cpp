@@ -1,14 +1,39 @@
 #include <iostream>
 #include <queue>
 #include <set>
+#include <cstring>
+#include <chrono>
+#include <algorithm>
 #include <glm/gtc/matrix_transform.hpp>
 
 #include "chunk.h"
 #include "texture.h"
+#include "chunk_render.h"
+#include "job_system.h"
+#include "epoch.h"
+#include "profiler.h"
+
+ChunkRegistry Chunk::chunkList;
+std::atomic<int> Chunk::meshingMode(MESHING_NAIVE);
+MeshQueue Chunk::finishedMeshes;
+std::atomic<uint64_t> Chunk::nextMeshVersion(1);
+
+// number of set bits
+static int countBits(uint32_t bits) {
+	bits = bits - ((bits >> 1) & 0x55555555u);
+	bits = (bits & 0x33333333u) + ((bits >> 2) & 0x33333333u);
+	return (((bits + (bits >> 4)) & 0x0F0F0F0Fu) * 0x01010101u) >> 24;
+}
 
-std::map<uint32_t, Chunk*> Chunk::chunkList = std::map<uint32_t, Chunk*>();
+// index of the lowest set bit (bits must not be 0)
+static int lowestBit(uint32_t bits) {
+	return countBits((bits & (0u - bits)) - 1);
+}
 
 void Chunk::updateChunksByNeighbor(Chunk* start) {
+	// neighbors can't be freed while they are being walked
+	EpochGuard guard;
+
 	// queue containing all chunks that need to be updated
 	std::queue<Chunk*> chunksToGo = std::queue<Chunk*>();
 	chunksToGo.push(start);
@@ -21,7 +46,7 @@ void Chunk::updateChunksByNeighbor(Chunk* start) {
 		// process next chunk waiting in queue
 		Chunk* current = chunksToGo.front();
 		chunksToGo.pop();
-		current->updateData();
+		submitUpdate(current);
 
 		// add unupdated neighbors to queue
 		for (int i = 0; i < 4; i++) {
@@ -35,19 +60,103 @@ void Chunk::updateChunksByNeighbor(Chunk* start) {
 }
 
 void Chunk::updateAllChunks() {
+	submitAllChunks();
+
+	// wait for the workers to finish
+	if (JobSystem::getActive() != nullptr) {
+		JobSystem::getActive()->wait();
+	}
+}
+
+void Chunk::submitAllChunks() {
+	EpochGuard guard;
+	std::vector<Chunk*> chunks;
+	chunkList.getAll(chunks);
+
 	// loop through chunklist
-	for (auto entry = chunkList.begin(); entry != chunkList.end(); entry++) {
-		Chunk* chunk = entry->second;
+	for (Chunk* chunk : chunks) {
 		// check for null chunks
 		if (chunk == nullptr) {
 			std::cerr << "Warning: null chunk found in chunkList" << std::endl;
 			continue;
 		}
 
+		submitUpdate(chunk);
+	}
+}
+
+int Chunk::getOutdatedCount() {
+	EpochGuard guard;
+	std::vector<Chunk*> chunks;
+	chunkList.getAll(chunks);
+
+	int outdated = 0;
+	for (Chunk* chunk : chunks) {
+		outdated += !chunk->isDataUpdated();
+	}
+	return outdated;
+}
+
+void Chunk::submitUpdate(Chunk* chunk) {
+	// meshing only writes the chunk's own data and reads its neighbors' block masks, so chunks can be meshed in parallel
+	// the job looks the chunk up again, since it could be removed before the job runs
+	if (JobSystem::getActive() != nullptr) {
+		ChunkKey key = getChunkIndex(chunk->pos.x, chunk->pos.z);
+		JobSystem::getActive()->submit([key] {
+			EpochGuard guard;
+			Chunk* chunk = chunkList.find(key);
+			if (chunk != nullptr) {
+				chunk->updateData();
+			}
+		});
+	}
+	else {
 		chunk->updateData();
 	}
 }
 
+void Chunk::setMeshingMode(int mode) {
+	meshingMode = mode;
+
+	// every chunk has to be remeshed with the new mode
+	EpochGuard guard;
+	std::vector<Chunk*> chunks;
+	chunkList.getAll(chunks);
+	for (Chunk* chunk : chunks) {
+		chunk->markFullRemesh();
+	}
+}
+
+int Chunk::getMeshingMode() {
+	return meshingMode;
+}
+
+void Chunk::printMeshReport() {
+	int chunkCount = 0;
+	size_t vertexCount = 0;
+	double totalTime = 0;
+	double maxTime = 0;
+
+	EpochGuard guard;
+	std::vector<Chunk*> chunks;
+	chunkList.getAll(chunks);
+	for (Chunk* chunk : chunks) {
+		chunkCount++;
+		vertexCount += chunk->meshedVertexCount;
+		totalTime += chunk->meshTime;
+		maxTime = std::max(maxTime, chunk->meshTime.load());
+	}
+
+	if (chunkCount == 0) {
+		std::cout << "Meshing: no chunks loaded." << std::endl;
+		return;
+	}
+
+	std::cout << "Meshing (" << (meshingMode == MESHING_GREEDY ? "greedy" : "naive") << "): " << chunkCount << " chunks, "
+		<< vertexCount << " vertices (" << vertexCount / chunkCount << " per chunk, " << vertexCount * sizeof(ChunkVertex) / 1024 << " KB total), "
+		<< totalTime / chunkCount << " ms per chunk (max " << maxTime << " ms)" << std::endl;
+}
+
 void Chunk::getChunkPosition(int globalX, int globalZ, int& chunkX, int& chunkZ) {
 	// two separate cases for positive and negative
 	if (globalX >= 0) {
@@ -76,6 +185,10 @@ void Chunk::getChunkPosition(int globalX, int globalZ, int& chunkX, int& chunkZ)
 }
 
 void Chunk::addBlock(std::string blockName, int x, int y, int z) {
+	addBlock(Block::getBlockId(blockName), x, y, z);
+}
+
+void Chunk::addBlock(BlockId id, int x, int y, int z) {
 	// make sure block is in bounds vertically
 	if (y < 0 || y >= WORLD_HEIGHT) {
 		std::cerr << "Attempted to add block out of bounds (y = " << y << ")." << std::endl;
@@ -88,60 +201,114 @@ void Chunk::addBlock(std::string blockName, int x, int y, int z) {
 	getChunkPosition(x, z, chunkX, chunkZ);
 
 	// calculate chunk index for map
-	uint32_t chunkIndex = getChunkIndex(chunkX, chunkZ);
-
-	// check if a chunk exists at the given position, if not create it
-	if (chunkList.find(chunkIndex) == chunkList.end()) {
-		chunkList[chunkIndex] = new Chunk(glm::ivec2(chunkX, chunkZ));
+	ChunkKey chunkIndex = getChunkIndex(chunkX, chunkZ);
+
+	// check if a chunk exists at the given position, if not create it (or use the one another thread added first)
+	EpochGuard guard;
+	Chunk* chunk = chunkList.find(chunkIndex);
+	if (chunk == nullptr) {
+		bool inserted;
+		chunk = create(glm::ivec2(chunkX, chunkZ), inserted);
 	}
 
 	// add block to the right chunk
-	Chunk* chunk = chunkList[chunkIndex];
-	chunk->blocks[x - chunkX][y][z - chunkZ] = new Block(blockName, x - chunkX, y, z - chunkZ);
-
-	// set update flags
-	chunk->dataUpdated = false;
-	chunk->bufferUpdated = false;
+	chunk->setBlock(id, x - chunkX, y, z - chunkZ);
+	chunk->saveDirty = true;
 }
 
 void Chunk::removeBlock(int x, int y, int z) {
+	// make sure block is in bounds vertically
+	if (y < 0 || y >= WORLD_HEIGHT) {
+		std::cerr << "Attempted to remove block out of bounds (y = " << y << ")." << std::endl;
+		return;
+	}
+
 	// calculate correct chunk position
 	int chunkX;
 	int chunkZ;
 	getChunkPosition(x, z, chunkX, chunkZ);
 
 	// calculate chunk index for map
-	uint32_t chunkIndex = getChunkIndex(chunkX, chunkZ);
+	ChunkKey chunkIndex = getChunkIndex(chunkX, chunkZ);
 
 	// check if a chunk exists at the given position
-	if (chunkList.find(chunkIndex) == chunkList.end()) {
+	EpochGuard guard;
+	Chunk* chunk = chunkList.find(chunkIndex);
+	if (chunk == nullptr) {
 		std::cerr << "Chunk for block position (x: " << x << ", y: " << y << ", z: " << z << ") does not exist!" << std::endl;
 		return;
 	}
 
-	// get block if it exists
-	Chunk* chunk = chunkList[chunkIndex];
-	Block* block = chunk->blocks[x - chunkX][y][z - chunkZ];
-
-	if (block == nullptr) {
+	// check if block exists
+	if (!chunk->hasBlock(x - chunkX, y, z - chunkZ)) {
 		std::cerr << "No block found at position (x: " << x << ", y: " << y << ", z: " << z << ")" << std::endl;
 		return;
 	}
 
-	// remove block from array and free its memory
-	chunk->blocks[x - chunkX][y][z - chunkZ] = nullptr;
-	delete block;
+	// remove block from storage
+	chunk->setBlock(BLOCK_AIR, x - chunkX, y, z - chunkZ);
+	chunk->saveDirty = true;
+}
+
+void Chunk::removeChunk(int x, int z) {
+	Chunk* chunk = chunkList.erase(getChunkIndex(x, z));
+	if (chunk == nullptr) {
+		std::cerr << "No chunk found at position (x: " << x << ", z: " << z << ")" << std::endl;
+		return;
+	}
+
+	// neighbors stop pointing at the chunk, and their edge faces are exposed now
+	chunk->unlinkNeighbors();
 
-	// set update flags
-	chunk->dataUpdated = false;
-	chunk->bufferUpdated = false;
+	// readers (renderer, meshing jobs) may still be using the chunk
+	Epoch::retire([chunk] { delete chunk; });
 }
 
-uint32_t Chunk::getChunkIndex(int x, int z) {
-	return (x << 16) + z;
+ChunkKey Chunk::getChunkIndex(int x, int z) {
+	// each coordinate keeps all 32 bits, so negative and far away chunks can't collide
+	return ((ChunkKey) (uint32_t) x << 32) | (uint32_t) z;
 }
 
-Chunk::Chunk(glm::ivec2 pos) : blocks(), neighborChunks(), verts(std::vector<Vertex>()) {
+void Chunk::printMemoryReport() {
+	size_t chunkCount = 0;
+	size_t solidCount = 0;
+	size_t storageBytes = 0;
+
+	EpochGuard guard;
+	std::vector<Chunk*> chunks;
+	chunkList.getAll(chunks);
+	for (Chunk* chunk : chunks) {
+		chunkCount++;
+		storageBytes += chunk->getMemoryUsage();
+
+		// count solid positions to estimate the old layout
+		std::shared_lock<std::shared_mutex> blockLock(chunk->blockMutex);
+		for (int i = 0; i < CHUNK_VOLUME; i++) {
+			if (!chunk->blocks.isEmpty(i)) {
+				solidCount++;
+			}
+		}
+	}
+
+	if (chunkCount == 0) {
+		std::cout << "Block memory: no chunks loaded." << std::endl;
+		return;
+	}
+
+	// old layout: a pointer per position, plus a heap Block (position, face bitmask, name string) per solid position
+	// the extra 16 bytes per Block are the heap allocation header
+	size_t legacyBytes = chunkCount * CHUNK_VOLUME * sizeof(void*) + solidCount * (sizeof(glm::ivec3) + sizeof(std::string) + sizeof(unsigned char) + 16);
+
+	std::cout << "Block memory: " << chunkCount << " chunks, " << storageBytes / chunkCount << " bytes per chunk (palette storage + face bits), "
+		<< legacyBytes / chunkCount << " bytes per chunk with Block pointers (" << 1.0 * legacyBytes / storageBytes << "x)" << std::endl;
+}
+
+Chunk::Chunk(glm::ivec2 pos, bool add) : blocks(CHUNK_VOLUME), blockMask(), opaqueMask(), faceMasks(), verts(std::vector<ChunkVertex>()), keepVerts(false), dataUpdated(false), fullRemesh(true), meshVersion(0), meshedVertexCount(0), meshTime(0),
+	saveDirty(false), renderState(nullptr) {
+	for (std::atomic<Chunk*>& neighbor : neighborChunks) {
+		neighbor = nullptr;
+	}
+
 	// check position
 	if (pos.x % CHUNK_SIZE != 0 || pos.y % CHUNK_SIZE != 0) {
 		std::cerr << "Invalid chunk position (x: " << pos.x << ", z: " << pos.y << ") given!" << std::endl;
@@ -152,275 +319,525 @@ Chunk::Chunk(glm::ivec2 pos) : blocks(), neighborChunks(), verts(std::vector<Ver
 	// set position
 	this->pos = glm::ivec3(pos.x, 0, pos.y);
 
-	// set model matrix
-	model = glm::translate(glm::mat4(1.0f), glm::vec3(this->pos));
-
 	// add to chunkList
-	chunkList[getChunkIndex(pos.x, pos.y)] = this;
+	if (!add) {
+		return;
+	}
+	if (!chunkList.insert(getChunkIndex(pos.x, pos.y), this)) {
+		std::cerr << "A chunk already exists at position (x: " << pos.x << ", z: " << pos.y << ")!" << std::endl;
+		return;
+	}
+
+	linkNeighbors();
+}
 
+Chunk::Chunk(glm::ivec2 pos) : Chunk(pos, true) {}
+
+Chunk* Chunk::create(glm::ivec2 pos, bool& inserted) {
+	inserted = false;
+	if (pos.x % CHUNK_SIZE != 0 || pos.y % CHUNK_SIZE != 0) {
+		std::cerr << "Invalid chunk position (x: " << pos.x << ", z: " << pos.y << ") given!" << std::endl;
+		return nullptr;
+	}
+
+	// the chunk is built before it's added, and only linked to its neighbors once the insert succeeded, so a chunk which lost to
+	// another thread was never seen by anyone and can be deleted right away
+	Chunk* chunk = new Chunk(pos, false);
+	Chunk* existing = nullptr;
+	inserted = chunkList.insert(getChunkIndex(pos.x, pos.y), chunk, &existing);
+	if (!inserted) {
+		delete chunk;
+		return existing;
+	}
+
+	chunk->linkNeighbors();
+	return chunk;
+}
+
+void Chunk::linkNeighbors() {
 	// check if neighbors exist, and if so, create a connection to them
 	Chunk* neighbor;
-	if (chunkList.find(getChunkIndex(pos.x, pos.y - CHUNK_SIZE)) != chunkList.end()) {
+	if ((neighbor = chunkList.find(getChunkIndex(pos.x, pos.z - CHUNK_SIZE))) != nullptr) {
 		// front
-		neighbor = chunkList[getChunkIndex(pos.x, pos.y - CHUNK_SIZE)];
 		neighborChunks[0] = neighbor;
 		neighbor->addNeighbor(this);
 	}
-	if (chunkList.find(getChunkIndex(pos.x + CHUNK_SIZE, pos.y)) != chunkList.end()) {
+	if ((neighbor = chunkList.find(getChunkIndex(pos.x + CHUNK_SIZE, pos.z))) != nullptr) {
 		// right
-		neighbor = chunkList[getChunkIndex(pos.x + CHUNK_SIZE, pos.y)];
 		neighborChunks[1] = neighbor;
 		neighbor->addNeighbor(this);
 	}
-	if (chunkList.find(getChunkIndex(pos.x, pos.y + CHUNK_SIZE)) != chunkList.end()) {
+	if ((neighbor = chunkList.find(getChunkIndex(pos.x, pos.z + CHUNK_SIZE))) != nullptr) {
 		// back
-		neighbor = chunkList[getChunkIndex(pos.x, pos.y + CHUNK_SIZE)];
 		neighborChunks[2] = neighbor;
 		neighbor->addNeighbor(this);
 	}
-	if (chunkList.find(getChunkIndex(pos.x - CHUNK_SIZE, pos.y)) != chunkList.end()) {
+	if ((neighbor = chunkList.find(getChunkIndex(pos.x - CHUNK_SIZE, pos.z))) != nullptr) {
 		// left
-		neighbor = chunkList[getChunkIndex(pos.x - CHUNK_SIZE, pos.y)];
 		neighborChunks[3] = neighbor;
 		neighbor->addNeighbor(this);
 	}
+}
+
+Chunk::~Chunk() {
+	// remove this chunk from the list (if removeChunk hasn't already)
+	chunkList.erase(getChunkIndex(pos.x, pos.z), this);
+	unlinkNeighbors();
+
+	// free the gpu side (mesh pool range and the mesh waiting to be uploaded)
+	delete renderState;
+}
+
+void Chunk::unlinkNeighbors() {
+	// neighbor i sees this chunk in the opposite direction (front <-> back, right <-> left)
+	for (int i = 0; i < 4; i++) {
+		Chunk* neighbor = neighborChunks[i];
+		if (neighbor == nullptr) {
+			continue;
+		}
+
+		Chunk* expected = this;
+		if (neighbor->neighborChunks[(i + 2) % 4].compare_exchange_strong(expected, nullptr)) {
+			neighbor->markFullRemesh();
+		}
+		neighborChunks[i] = nullptr;
+	}
+}
 
-	// generate vao and set attributes
-	glGenVertexArrays(1, &vaoId);
-	glGenBuffers(1, &bufferId);
+void Chunk::markFullRemesh() {
+	// set before dataUpdated, so the meshing which sees dataUpdated cleared also sees this
+	fullRemesh = true;
+	dataUpdated = false;
+}
 
-	// bind buffer to vao
-	glBindVertexArray(vaoId);
-	glBindBuffer(GL_ARRAY_BUFFER, bufferId);
+void Chunk::addEditedCell(int index) {
+	if (fullRemesh) {
+		return;
+	}
 
-	// set vertex attribs
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*) 0);
-	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*) (3 * sizeof(float)));
-	glEnableVertexAttribArray(0);
-	glEnableVertexAttribArray(1);
+	// past a point, checking every face is cheaper than patching cell by cell
+	if (editedCells.size() >= MAX_PATCHED_CELLS) {
+		editedCells.clear();
+		fullRemesh = true;
+		return;
+	}
+	editedCells.push_back(index);
 }
 
-Chunk::~Chunk() {
-	// remove this chunk from the list
-	chunkList.erase(getChunkIndex(pos.x, pos.z));
+void Chunk::editNeighborCells(int side, const uint32_t changed[CHUNK_SIZE]) {
+	Chunk* neighbor = neighborChunks[side];
+	if (neighbor == nullptr) {
+		return;
+	}
+
+	// the neighbor only has a face there if it has a block there
+	std::unique_lock<std::shared_mutex> lock(neighbor->blockMutex);
+	bool edited = false;
+	for (int i = 0; i < CHUNK_SIZE; i++) {
+		// neighbor column touching position i along the edge
+		int x = (side == 1) ? 0 : (side == 3) ? CHUNK_SIZE - 1 : i;
+		int z = (side == 0) ? CHUNK_SIZE - 1 : (side == 2) ? 0 : i;
+		for (uint32_t cells = changed[i] & neighbor->blockMask[x][z]; cells != 0; cells &= cells - 1) {
+			neighbor->addEditedCell(getBlockIndex(x, lowestBit(cells), z));
+			edited = true;
+		}
+	}
+
+	if (edited) {
+		neighbor->dataUpdated = false;
+	}
 }
 
-void Chunk::updateBlockFaces() {
-	// loop through all chunk blocks
+void Chunk::copyNeighborEdges(uint32_t edges[4][CHUNK_SIZE]) {
+	// column of each neighbor which touches this chunk at position i along the edge
+	for (int side = 0; side < 4; side++) {
+		Chunk* neighbor = neighborChunks[side];
+		if (neighbor == nullptr) {
+			memset(edges[side], 0, sizeof(edges[side]));
+			continue;
+		}
+
+		// only one chunk is locked at a time, so meshing neighbors can't deadlock
+		std::shared_lock<std::shared_mutex> lock(neighbor->blockMutex);
+		for (int i = 0; i < CHUNK_SIZE; i++) {
+			switch (side) {
+			case 0:
+				edges[side][i] = neighbor->opaqueMask[i][CHUNK_SIZE - 1];
+				break;
+			case 1:
+				edges[side][i] = neighbor->opaqueMask[0][i];
+				break;
+			case 2:
+				edges[side][i] = neighbor->opaqueMask[i][0];
+				break;
+			default:
+				edges[side][i] = neighbor->opaqueMask[CHUNK_SIZE - 1][i];
+				break;
+			}
+		}
+	}
+}
+
+void Chunk::updateBlockFaces(const uint32_t neighborEdges[4][CHUNK_SIZE]) {
+	PROFILE_ZONE("Chunk::updateBlockFaces");
+
 	for (int x = 0; x < CHUNK_SIZE; x++) {
 		for (int z = 0; z < CHUNK_SIZE; z++) {
-			for (int y = 0; y < WORLD_HEIGHT; y++) {
-				// set face status of neighbor blocks depending on this one
-				// if this block exists, neighbor blocks have hidden faces
-				// if it doesn't exist, neighbor blocks have exposed faces
-				bool exposed = (blocks[x][y][z] == nullptr);
-
-				// set status of neighbor blocks, if they exist
-				Block* neighbor;
-				if (x + 1 < CHUNK_SIZE && (neighbor = blocks[x + 1][y][z]) != nullptr) {
-					neighbor->boolFace(BIT_FACE_LEFT, exposed);
-				}
-				if (x - 1 >= 0 && (neighbor = blocks[x - 1][y][z]) != nullptr) {
-					neighbor->boolFace(BIT_FACE_RIGHT, exposed);
-				}
-				if (y + 1 < WORLD_HEIGHT && (neighbor = blocks[x][y + 1][z]) != nullptr) {
-					neighbor->boolFace(BIT_FACE_BOTTOM, exposed);
-				}
-				if (y - 1 >= 0 && (neighbor = blocks[x][y - 1][z]) != nullptr) {
-					neighbor->boolFace(BIT_FACE_TOP, exposed);
-				}
-				if (z + 1 < CHUNK_SIZE && (neighbor = blocks[x][y][z + 1]) != nullptr) {
-					neighbor->boolFace(BIT_FACE_FRONT, exposed);
-				}
-				if (z - 1 >= 0 && (neighbor = blocks[x][y][z - 1]) != nullptr) {
-					neighbor->boolFace(BIT_FACE_BACK, exposed);
-				}
+			updateColumnFaces(x, z, neighborEdges);
+		}
+	}
+}
 
-				// if this is the top or bottom, expose top/bottom face
-				if (y == 0) {
-					if (blocks[x][y][z] != nullptr) {
-						blocks[x][y][z]->setFace(BIT_FACE_BOTTOM);
-					}
-				}
-				else if (y == WORLD_HEIGHT - 1) {
-					if (blocks[x][y][z] != nullptr) {
-						blocks[x][y][z]->setFace(BIT_FACE_TOP);
-					}
-				}
+void Chunk::updateColumnFaces(int x, int z, const uint32_t neighborEdges[4][CHUNK_SIZE]) {
+	// a face is exposed if there is no opaque block next to it, so each face mask is the column's blocks
+	// minus the neighboring column's opaque bits (shifted by one for top/bottom)
+	uint32_t column = blockMask[x][z];
+
+	// top and bottom: zeros are shifted in at the ends, so the top and bottom of the world are always exposed
+	faceMasks[FACE_TOP][x][z] = column & ~(opaqueMask[x][z] >> 1);
+	faceMasks[FACE_BOTTOM][x][z] = column & ~(opaqueMask[x][z] << 1);
+
+	// sides on chunk boundaries use the neighbor chunk's edge column, and are exposed if there is no neighbor
+	uint32_t frontColumn = (z - 1 >= 0) ? opaqueMask[x][z - 1] : neighborEdges[0][x];
+	uint32_t backColumn = (z + 1 < CHUNK_SIZE) ? opaqueMask[x][z + 1] : neighborEdges[2][x];
+	uint32_t rightColumn = (x + 1 < CHUNK_SIZE) ? opaqueMask[x + 1][z] : neighborEdges[1][z];
+	uint32_t leftColumn = (x - 1 >= 0) ? opaqueMask[x - 1][z] : neighborEdges[3][z];
+
+	faceMasks[FACE_FRONT][x][z] = column & ~frontColumn;
+	faceMasks[FACE_BACK][x][z] = column & ~backColumn;
+	faceMasks[FACE_RIGHT][x][z] = column & ~rightColumn;
+	faceMasks[FACE_LEFT][x][z] = column & ~leftColumn;
+}
+
+void Chunk::updateEditedFaces(const uint32_t neighborEdges[4][CHUNK_SIZE], bool patchVerts) {
+	PROFILE_ZONE("Chunk::updateEditedFaces");
+
+	// an edit can change the faces of its own cell and the facing sides of the six cells around it,
+	// which all lie in the edited column and the four columns next to it
+	uint64_t columns = 0;
+	uint32_t replaced[CHUNK_SIZE][CHUNK_SIZE] = {};		// edited cells of each column, their sprites can change even if their faces don't
+	for (uint16_t cell : meshCells) {
+		int x = cell / (CHUNK_SIZE * WORLD_HEIGHT);
+		int z = cell / WORLD_HEIGHT % CHUNK_SIZE;
+		replaced[x][z] |= 1u << (cell % WORLD_HEIGHT);
+
+		columns |= 1ull << (x * CHUNK_SIZE + z);
+		columns |= (x - 1 >= 0) ? 1ull << ((x - 1) * CHUNK_SIZE + z) : 0;
+		columns |= (x + 1 < CHUNK_SIZE) ? 1ull << ((x + 1) * CHUNK_SIZE + z) : 0;
+		columns |= (z - 1 >= 0) ? 1ull << (x * CHUNK_SIZE + z - 1) : 0;
+		columns |= (z + 1 < CHUNK_SIZE) ? 1ull << (x * CHUNK_SIZE + z + 1) : 0;
+	}
+
+	if (!patchVerts) {
+		for (int column = 0; column < CHUNK_SIZE * CHUNK_SIZE; column++) {
+			if ((columns >> column) & 1) {
+				updateColumnFaces(column / CHUNK_SIZE, column % CHUNK_SIZE, neighborEdges);
 			}
 		}
+		return;
 	}
 
-	// use neighbors to calculate exposed faces on chunk boundaries
-	// front and back faces
-	Chunk* front = neighborChunks[0];
-	Chunk* back = neighborChunks[2];
+	// verts holds the quads in updateVerts order (column by column, then y, then face), so a cell's quads are found by
+	// counting the faces before it, and are replaced in place, which keeps verts the same as a full updateVerts would make it
+	size_t quad = 0;	// index of the first quad of the current cell
 	for (int x = 0; x < CHUNK_SIZE; x++) {
-		for (int y = 0; y < WORLD_HEIGHT; y++) {
-			// front
-			if (blocks[x][y][0] != nullptr) {
-				if (front != nullptr) {
-					// check corresponding block on neighbor
-					bool expose = (front->blocks[x][y][CHUNK_SIZE - 1] == nullptr);
-					blocks[x][y][0]->boolFace(BIT_FACE_FRONT, expose);
-				}
-				else {
-					// no neighbor, so expose face
-					blocks[x][y][0]->setFace(BIT_FACE_FRONT);
+		for (int z = 0; z < CHUNK_SIZE; z++) {
+			if (!((columns >> (x * CHUNK_SIZE + z)) & 1)) {
+				for (int face = 0; face < FACE_COUNT; face++) {
+					quad += countBits(faceMasks[face][x][z]);
 				}
+				continue;
+			}
+
+			uint32_t oldFaces[FACE_COUNT];
+			for (int face = 0; face < FACE_COUNT; face++) {
+				oldFaces[face] = faceMasks[face][x][z];
+			}
+			updateColumnFaces(x, z, neighborEdges);
+
+			uint32_t changed = replaced[x][z];
+			for (int face = 0; face < FACE_COUNT; face++) {
+				changed |= oldFaces[face] ^ faceMasks[face][x][z];
 			}
 
-			// back
-			if (blocks[x][y][CHUNK_SIZE - 1] != nullptr) {
-				if (back != nullptr) {
-					// check corresponding block on neighbor
-					bool expose = (back->blocks[x][y][0] == nullptr);
-					blocks[x][y][CHUNK_SIZE - 1]->boolFace(BIT_FACE_BACK, expose);
+			for (int y = 0; y < WORLD_HEIGHT; y++) {
+				int oldCount = 0;
+				int newCount = 0;
+				for (int face = 0; face < FACE_COUNT; face++) {
+					oldCount += (oldFaces[face] >> y) & 1;
+					newCount += (faceMasks[face][x][z] >> y) & 1;
 				}
-				else {
-					// no neighbor, so expose face
-					blocks[x][y][CHUNK_SIZE - 1]->setFace(BIT_FACE_BACK);
+
+				if ((changed >> y) & 1) {
+					// remove the cell's old quads (4 verts each), append the new ones and rotate them into place
+					verts.erase(verts.begin() + quad * 4, verts.begin() + (quad + oldCount) * 4);
+					size_t appended = verts.size();
+					BlockId id = blocks.get(getBlockIndex(x, y, z));
+					for (int face = 0; face < FACE_COUNT; face++) {
+						if ((faceMasks[face][x][z] >> y) & 1) {
+							addFace(face, glm::ivec3(x, y, z), glm::ivec3(1, 1, 1), Block::getFaceOffset(id, face));
+						}
+					}
+					std::rotate(verts.begin() + quad * 4, verts.begin() + appended, verts.end());
 				}
+				quad += newCount;
 			}
 		}
 	}
+}
+
+void Chunk::updateBlockFacesPerBlock() {
+	PROFILE_ZONE("Chunk::updateBlockFacesPerBlock");
 
-	// left and right faces
+	// neighbor chunks, used for faces on chunk boundaries
+	Chunk* front = neighborChunks[0];
 	Chunk* right = neighborChunks[1];
+	Chunk* back = neighborChunks[2];
 	Chunk* left = neighborChunks[3];
-	for (int z = 0; z < CHUNK_SIZE; z++) {
-		for (int y = 0; y < WORLD_HEIGHT; y++) {
-			// left
-			if (blocks[0][y][z] != nullptr) {
-				if (left != nullptr) {
-					// check corresponding block on neighbor
-					bool expose = (left->blocks[CHUNK_SIZE - 1][y][z] == nullptr);
-					blocks[0][y][z]->boolFace(BIT_FACE_LEFT, expose);
+
+	// the neighbors lock themselves in isOpaque
+	std::shared_lock<std::shared_mutex> blockLock(blockMutex);
+
+	// clear old faces
+	memset(faceMasks, 0, sizeof(faceMasks));
+
+	// loop through all chunk blocks
+	for (int x = 0; x < CHUNK_SIZE; x++) {
+		for (int z = 0; z < CHUNK_SIZE; z++) {
+			for (int y = 0; y < WORLD_HEIGHT; y++) {
+				// empty positions have no faces
+				if (blocks.isEmpty(getBlockIndex(x, y, z))) {
+					continue;
+				}
+
+				// a face is exposed if there is no opaque block next to it
+				unsigned char faces = 0;
+
+				// top and bottom of the world are always exposed
+				if (y + 1 >= WORLD_HEIGHT || !Block::isOpaque(blocks.get(getBlockIndex(x, y + 1, z)))) {
+					faces |= BIT_FACE_TOP;
 				}
-				else {
-					// no neighbor, so expose face
-					blocks[0][y][z]->setFace(BIT_FACE_LEFT);
+				if (y - 1 < 0 || !Block::isOpaque(blocks.get(getBlockIndex(x, y - 1, z)))) {
+					faces |= BIT_FACE_BOTTOM;
 				}
-			}
 
-			// right
-			if (blocks[CHUNK_SIZE - 1][y][z] != nullptr) {
-				if (right != nullptr) {
-					// check corresponding block on neighbor
-					bool expose = (right->blocks[0][y][z] == nullptr);
-					blocks[CHUNK_SIZE - 1][y][z]->boolFace(BIT_FACE_RIGHT, expose);
+				// faces on chunk boundaries check the neighbor chunk, and are exposed if there is no neighbor
+				if (z - 1 >= 0 ? !Block::isOpaque(blocks.get(getBlockIndex(x, y, z - 1))) : (front == nullptr || !front->isOpaque(x, y, CHUNK_SIZE - 1))) {
+					faces |= BIT_FACE_FRONT;
+				}
+				if (z + 1 < CHUNK_SIZE ? !Block::isOpaque(blocks.get(getBlockIndex(x, y, z + 1))) : (back == nullptr || !back->isOpaque(x, y, 0))) {
+					faces |= BIT_FACE_BACK;
+				}
+				if (x + 1 < CHUNK_SIZE ? !Block::isOpaque(blocks.get(getBlockIndex(x + 1, y, z))) : (right == nullptr || !right->isOpaque(0, y, z))) {
+					faces |= BIT_FACE_RIGHT;
 				}
-				else {
-					// no neighbor, so expose face
-					blocks[CHUNK_SIZE - 1][y][z]->setFace(BIT_FACE_RIGHT);
+				if (x - 1 >= 0 ? !Block::isOpaque(blocks.get(getBlockIndex(x - 1, y, z))) : (left == nullptr || !left->isOpaque(CHUNK_SIZE - 1, y, z))) {
+					faces |= BIT_FACE_LEFT;
+				}
+
+				// copy the face bits into the column masks
+				for (int face = 0; face < FACE_COUNT; face++) {
+					if (faces & (1 << face)) {
+						faceMasks[face][x][z] |= 1u << y;
+					}
 				}
 			}
 		}
 	}
 }
 
-void Chunk::addFace(const Vertex* face, int x, int y, int z, int uOffset, int vOffset) {
-	// calculate the size of a single block in spritesheet coordinates
-	static const float BLOCK_SIZE_X = 1.0f * BLOCK_SPRITE_UNIT / Block::getSpriteWidth();
-	static const float BLOCK_SIZE_Y = 1.0f * BLOCK_SPRITE_UNIT / Block::getSpriteHeight();
+void Chunk::updateHeightBounds(int& minHeight, int& maxHeight) {
+	// combine the faces of all columns
+	uint32_t faces = 0;
+	for (int face = 0; face < FACE_COUNT; face++) {
+		for (int x = 0; x < CHUNK_SIZE; x++) {
+			for (int z = 0; z < CHUNK_SIZE; z++) {
+				faces |= faceMasks[face][x][z];
+			}
+		}
+	}
+
+	// empty chunks have an empty range
+	minHeight = 0;
+	maxHeight = 0;
+	if (faces == 0) {
+		return;
+	}
+
+	// lowest and highest set bits
+	while (!((faces >> minHeight) & 1)) {
+		minHeight++;
+	}
+	maxHeight = WORLD_HEIGHT;
+	while (!((faces >> (maxHeight - 1)) & 1)) {
+		maxHeight--;
+	}
+}
+
+void Chunk::addFace(int face, glm::ivec3 pos, glm::ivec3 size, glm::ivec2 spriteOffset) {
+	// axes which the texture u and v coords run along for each face (0 = x, 1 = y, 2 = z)
+	static const int FACE_U_AXIS[FACE_COUNT] = { 0, 0, 0, 0, 2, 2 };
+	static const int FACE_V_AXIS[FACE_COUNT] = { 2, 2, 1, 1, 1, 1 };
 
-	// loop through all 6 verts of this face
-	for (const Vertex* vertPtr = face; vertPtr < face + 6; vertPtr++) {
+	// loop through all 4 verts of this face
+	const Vertex* faceVerts = Block::getFaceVertices(face);
+	for (const Vertex* vertPtr = faceVerts; vertPtr < faceVerts + 4; vertPtr++) {
 		// new vertex which will be added to the verts list
 		Vertex outVert = *vertPtr;
 
-		// shift position to be at right spot
-		outVert.pos[0] += 0.5 + x;
-		outVert.pos[1] += 0.5 + y;
-		outVert.pos[2] += 0.5 + z;
+		// stretch the unit face to the given size and shift position to be at right spot
+		for (int axis = 0; axis < 3; axis++) {
+			outVert.pos[axis] = (outVert.pos[axis] + 0.5f) * size[axis] + pos[axis];
+		}
+
+		// scale texture coords by the size, so the sprite repeats once per block instead of stretching
+		outVert.texturePos[0] *= size[FACE_U_AXIS[face]];
+		outVert.texturePos[1] *= size[FACE_V_AXIS[face]];
 
-		// shift texture coords using offset
-		outVert.texturePos[0] = BLOCK_SIZE_X * (outVert.texturePos[0] + uOffset);
-		outVert.texturePos[1] = BLOCK_SIZE_Y * (outVert.texturePos[1] + vOffset);
+		// sprite position in the spritesheet
+		outVert.spriteOffset[0] = spriteOffset.x;
+		outVert.spriteOffset[1] = spriteOffset.y;
 
 		// add to verts
+#if PACKED_VERTICES
+		verts.push_back(PackedVertex(outVert, face));
+#else
 		verts.push_back(outVert);
+#endif
 	}
 }
 
 void Chunk::updateVerts() {
+	PROFILE_ZONE("Chunk::updateVerts");
+
 	verts.clear();
 
 	// loop through all block positions
 	for (int x = 0; x < CHUNK_SIZE; x++) {
 		for (int z = 0; z < CHUNK_SIZE; z++) {
 			for (int y = 0; y < WORLD_HEIGHT; y++) {
-				Block* block;
-				if ((block = blocks[x][y][z]) == nullptr) {
-					continue;
+				// gather the face bits of this block from the column masks
+				unsigned char faces = 0;
+				for (int face = 0; face < FACE_COUNT; face++) {
+					faces |= ((faceMasks[face][x][z] >> y) & 1) << face;
 				}
 
-				// if all faces are hidden, continue
-				if (!block->getFace(BIT_FACE_ALL)) {
+				// if all faces are hidden (or there is no block), continue
+				if (!(faces & BIT_FACE_ALL)) {
 					continue;
 				}
 
-				// get texture
-				if (getBlockTextures().find(block->getName()) == getBlockTextures().end()) {
-					std::cerr << "Warning: block texture for block named \"" << block->getName() << "\" not found." << std::endl;
-				}
-				BlockTexture texture = getBlockTextures().at(block->getName());
-
-				// this texture's position in the spritesheet
-				glm::ivec2 textureOffset;
+				// block type, used to look up face textures in the registry
+				BlockId id = blocks.get(getBlockIndex(x, y, z));
 
 				// add exposed faces
-				if (block->getFace(BIT_FACE_TOP)) {
-					textureOffset = Block::getBlockTextureOffset(texture.top);
-					addFace(Block::TOP_FACE, x, y, z, textureOffset.x, textureOffset.y);
-				}
-				if (block->getFace(BIT_FACE_BOTTOM)) {
-					textureOffset = Block::getBlockTextureOffset(texture.bottom);
-					addFace(Block::BOTTOM_FACE, x, y, z, textureOffset.x, textureOffset.y);
-				}
-				if (block->getFace(BIT_FACE_LEFT)) {
-					textureOffset = Block::getBlockTextureOffset(texture.left);
-					addFace(Block::LEFT_FACE, x, y, z, textureOffset.x, textureOffset.y);
-				}
-				if (block->getFace(BIT_FACE_RIGHT)) {
-					textureOffset = Block::getBlockTextureOffset(texture.right);
-					addFace(Block::RIGHT_FACE, x, y, z, textureOffset.x, textureOffset.y);
-				}
-				if (block->getFace(BIT_FACE_FRONT)) {
-					textureOffset = Block::getBlockTextureOffset(texture.front);
-					addFace(Block::FRONT_FACE, x, y, z, textureOffset.x, textureOffset.y);
-				}
-				if (block->getFace(BIT_FACE_BACK)) {
-					textureOffset = Block::getBlockTextureOffset(texture.back);
-					addFace(Block::BACK_FACE, x, y, z, textureOffset.x, textureOffset.y);
+				for (int face = 0; face < FACE_COUNT; face++) {
+					if (faces & (1 << face)) {
+						addFace(face, glm::ivec3(x, y, z), glm::ivec3(1, 1, 1), Block::getFaceOffset(id, face));
+					}
 				}
 			}
 		}
 	}
 }
 
-void Chunk::updateBuffer() {
-	// if buffer is up to date, do nothing
-	if (bufferUpdated) {
-		return;
-	}
+void Chunk::updateVertsGreedy() {
+	PROFILE_ZONE("Chunk::updateVertsGreedy");
 
-	// if data hasn't been updated, warn user and stop
-	if (!dataUpdated) {
-		std::cerr << "Attempted to update buffer without updating data." << std::endl;
-		return;
-	}
+	verts.clear();
 
-	// if verts is empty, continue
-	if (verts.empty()) {
-		return;
-	}
+	// axes of the slices for each face: normal is the axis the face points along, u/v are the axes of the slice
+	static const int FACE_NORMAL_AXIS[FACE_COUNT] = { 1, 1, 2, 2, 0, 0 };
+	static const int SLICE_U_AXIS[FACE_COUNT] = { 0, 0, 0, 0, 2, 2 };
+	static const int SLICE_V_AXIS[FACE_COUNT] = { 2, 2, 1, 1, 1, 1 };
+	static const int CHUNK_DIMENSIONS[3] = { CHUNK_SIZE, WORLD_HEIGHT, CHUNK_SIZE };
+
+	// sprite of each exposed face in the current slice, packed as (u << 16 | v) + 1, 0 = no face
+	uint32_t sprites[CHUNK_SIZE * WORLD_HEIGHT];
+
+	for (int face = 0; face < FACE_COUNT; face++) {
+		int normalAxis = FACE_NORMAL_AXIS[face];
+		int uAxis = SLICE_U_AXIS[face];
+		int vAxis = SLICE_V_AXIS[face];
+		int width = CHUNK_DIMENSIONS[uAxis];
+		int height = CHUNK_DIMENSIONS[vAxis];
+
+		for (int slice = 0; slice < CHUNK_DIMENSIONS[normalAxis]; slice++) {
+			// fill in the sprites of this slice
+			bool empty = true;
+			for (int v = 0; v < height; v++) {
+				for (int u = 0; u < width; u++) {
+					glm::ivec3 blockPos;
+					blockPos[normalAxis] = slice;
+					blockPos[uAxis] = u;
+					blockPos[vAxis] = v;
+
+					uint32_t sprite = 0;
+					if ((faceMasks[face][blockPos.x][blockPos.z] >> blockPos.y) & 1) {
+						glm::ivec2 offset = Block::getFaceOffset(blocks.get(getBlockIndex(blockPos.x, blockPos.y, blockPos.z)), face);
+						sprite = ((offset.x << 16) | offset.y) + 1;
+						empty = false;
+					}
+					sprites[v * width + u] = sprite;
+				}
+			}
+
+			if (empty) {
+				continue;
+			}
 
-	// update buffer with verts
-	glNamedBufferData(bufferId, verts.size() * sizeof(Vertex), &verts[0], GL_DYNAMIC_DRAW);
+			// merge faces with the same sprite into rectangles, growing along u first and then v
+			for (int v = 0; v < height; v++) {
+				for (int u = 0; u < width; u++) {
+					uint32_t sprite = sprites[v * width + u];
+					if (sprite == 0) {
+						continue;
+					}
+
+					// widest run of this sprite in this row
+					int quadWidth = 1;
+					while (u + quadWidth < width && sprites[v * width + u + quadWidth] == sprite) {
+						quadWidth++;
+					}
+
+					// extend down the following rows while the whole run matches
+					int quadHeight = 1;
+					while (v + quadHeight < height) {
+						bool rowMatches = true;
+						for (int i = 0; i < quadWidth; i++) {
+							if (sprites[(v + quadHeight) * width + u + i] != sprite) {
+								rowMatches = false;
+								break;
+							}
+						}
+						if (!rowMatches) {
+							break;
+						}
+						quadHeight++;
+					}
 
-	// update flag
-	bufferUpdated = true;
+					// clear the merged faces so they aren't used again
+					for (int j = 0; j < quadHeight; j++) {
+						for (int i = 0; i < quadWidth; i++) {
+							sprites[(v + j) * width + u + i] = 0;
+						}
+					}
+
+					// add the merged face
+					glm::ivec3 quadPos, quadSize;
+					quadPos[normalAxis] = slice;
+					quadPos[uAxis] = u;
+					quadPos[vAxis] = v;
+					quadSize[normalAxis] = 1;
+					quadSize[uAxis] = quadWidth;
+					quadSize[vAxis] = quadHeight;
+
+					sprite--;
+					addFace(face, quadPos, quadSize, glm::ivec2(sprite >> 16, sprite & 0xFFFF));
+				}
+			}
+		}
+	}
 }
 
 void Chunk::addNeighbor(Chunk* chunk) {
@@ -451,52 +868,326 @@ void Chunk::addNeighbor(Chunk* chunk) {
 		// left
 		neighborChunks[3] = chunk;
 	}
+
+	// the faces along the shared edge have to be checked again (once the meshing can see the neighbor)
+	markFullRemesh();
 }
 
 void Chunk::updateData() {
-	// don't do anything if update isn't needed
-	if (dataUpdated) {
+	PROFILE_ZONE("Chunk::updateData");
+
+	// only one worker meshes a chunk at a time
+	std::lock_guard<std::mutex> meshLock(meshMutex);
+
+	// don't do anything if update isn't needed, edits made from here on mark the chunk for another update
+	if (dataUpdated.exchange(true)) {
 		return;
 	}
 
-	// call the update functions
-	updateBlockFaces();
-	updateVerts();
+	// take the edits made so far before copying the neighbor edges, so the edges include any neighbor edit which marked a cell here
+	// the mode is read with them, a mode change after this marks the chunk for another full remesh
+	bool full;
+	int mode;
+	{
+		std::unique_lock<std::shared_mutex> blockLock(blockMutex);
+		meshCells.swap(editedCells);
+		full = fullRemesh.exchange(false);
+		mode = meshingMode;
+	}
+	bool patchVerts = !full && mode == MESHING_NAIVE && keepVerts;
+
+	uint32_t neighborEdges[4][CHUNK_SIZE];
+	copyNeighborEdges(neighborEdges);
+
+	// build the mesh into its own buffers, so nothing the render thread is using is touched
+	ChunkMesh* newMesh = new ChunkMesh();
+	newMesh->key = getChunkIndex(pos.x, pos.z);
+	{
+		std::shared_lock<std::shared_mutex> blockLock(blockMutex);
+
+		// call the update functions, timing the meshing (edits only update the faces around them, and patch naive meshes)
+		auto meshStart = std::chrono::steady_clock::now();
+		if (full) {
+			updateBlockFaces(neighborEdges);
+		}
+		else {
+			updateEditedFaces(neighborEdges, patchVerts);
+		}
+		updateHeightBounds(newMesh->minHeight, newMesh->maxHeight);
 
-	// if verts is empty, no need to do anything with this chunk
-	if (verts.empty()) {
+		if (mode == MESHING_GREEDY) {
+			updateVertsGreedy();
+		}
+		else if (!patchVerts) {
+			updateVerts();
+		}
+		meshTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - meshStart).count();
+	}
+
+	// edited chunks keep their naive mesh for the next edit to patch, the others hand it over
+	keepVerts = keepVerts || (!meshCells.empty() && mode == MESHING_NAIVE);
+	meshCells.clear();
+	if (keepVerts && mode == MESHING_NAIVE) {
+		newMesh->verts = verts;
+	}
+	else {
+		// nothing is left to patch (this also stops a later naive remesh from patching after a greedy one)
+		newMesh->verts = std::move(verts);
+		verts.clear();
+		keepVerts = false;
+	}
+	meshedVertexCount = newMesh->verts.size();
+
+	// newer than any mesh of this chunk built so far, so the render thread can drop older ones
+	newMesh->version = nextMeshVersion++;
+	meshVersion = newMesh->version;
+
+	stageMesh(newMesh);
+	finishedMeshes.push(newMesh);
+}
+
+void Chunk::stageMesh(ChunkMesh* mesh) {
+	if (mesh->verts.empty()) {
 		return;
 	}
 
+	// if the ring is full, upload sends verts directly instead
+	size_t bytes = mesh->verts.size() * sizeof(ChunkVertex);
+	if (StagingRing::reserve(bytes, mesh->staged)) {
+		memcpy(mesh->staged.data, &mesh->verts[0], bytes);
+	}
+}
+
+int Chunk::getBlockIndex(int x, int y, int z) {
+	return (x * CHUNK_SIZE + z) * WORLD_HEIGHT + y;
+}
+
+BlockId Chunk::getBlock(int x, int y, int z) {
+	std::shared_lock<std::shared_mutex> lock(blockMutex);
+	return blocks.get(getBlockIndex(x, y, z));
+}
+
+void Chunk::setBlock(BlockId id, int x, int y, int z) {
+	bool opaqueChanged;
+	{
+		std::unique_lock<std::shared_mutex> lock(blockMutex);
+		blocks.set(getBlockIndex(x, y, z), id);
+
+		// update the column bitmasks
+		uint32_t bit = 1u << y;
+		opaqueChanged = ((opaqueMask[x][z] & bit) != 0) != Block::isOpaque(id);
+		if (id != BLOCK_AIR) {
+			blockMask[x][z] |= bit;
+		}
+		else {
+			blockMask[x][z] &= ~bit;
+		}
+		if (Block::isOpaque(id)) {
+			opaqueMask[x][z] |= bit;
+		}
+		else {
+			opaqueMask[x][z] &= ~bit;
+		}
+
+		// set update flag, the next meshing only checks the faces around this cell
+		addEditedCell(getBlockIndex(x, y, z));
+		dataUpdated = false;
+	}
+
+	// neighbor faces touching this cell are only hidden by opaque blocks, so they only change if the opacity did
+	// (locked one chunk at a time, like copyNeighborEdges)
+	if (opaqueChanged) {
+		// position of the cell along each edge (front, right, back, left), -1 if it isn't on that edge
+		int edgePos[4] = { (z == 0) ? x : -1, (x == CHUNK_SIZE - 1) ? z : -1, (z == CHUNK_SIZE - 1) ? x : -1, (x == 0) ? z : -1 };
+		for (int side = 0; side < 4; side++) {
+			if (edgePos[side] >= 0) {
+				uint32_t changed[CHUNK_SIZE] = {};
+				changed[edgePos[side]] = 1u << y;
+				editNeighborCells(side, changed);
+			}
+		}
+	}
+}
+
+void Chunk::setBlocks(const BlockId* ids) {
+	std::unique_lock<std::shared_mutex> lock(blockMutex);
+	blocks.setAll(ids);
+
+	// rebuild the column bitmasks
+	for (int x = 0; x < CHUNK_SIZE; x++) {
+		for (int z = 0; z < CHUNK_SIZE; z++) {
+			const BlockId* column = ids + getBlockIndex(x, 0, z);
+			uint32_t blockColumn = 0;
+			uint32_t opaqueColumn = 0;
+			for (int y = 0; y < WORLD_HEIGHT; y++) {
+				if (column[y] != BLOCK_AIR) {
+					blockColumn |= 1u << y;
+				}
+				if (Block::isOpaque(column[y])) {
+					opaqueColumn |= 1u << y;
+				}
+			}
+			blockMask[x][z] = blockColumn;
+			opaqueMask[x][z] = opaqueColumn;
+		}
+	}
+
 	// set update flag
-	dataUpdated = true;
+	editedCells.clear();
+	fullRemesh = true;
+	dataUpdated = false;
+	lock.unlock();
+
+	// every edge changed, so the neighbors check all their faces again too
+	for (int i = 0; i < 4; i++) {
+		Chunk* neighbor = neighborChunks[i];
+		if (neighbor != nullptr) {
+			neighbor->markFullRemesh();
+		}
+	}
 }
 
-bool Chunk::isDataUpdated() {
-	return dataUpdated;
+int Chunk::fillBlocks(BlockId id, const uint32_t cells[CHUNK_SIZE][CHUNK_SIZE]) {
+	return editBlocks(id, nullptr, cells);
+}
+
+int Chunk::pasteBlocks(const BlockId* ids, const uint32_t cells[CHUNK_SIZE][CHUNK_SIZE]) {
+	return editBlocks(BLOCK_AIR, ids, cells);
+}
+
+int Chunk::editBlocks(BlockId fillId, const BlockId* ids, const uint32_t cells[CHUNK_SIZE][CHUNK_SIZE]) {
+	int cellCount = 0;
+	for (int x = 0; x < CHUNK_SIZE; x++) {
+		for (int z = 0; z < CHUNK_SIZE; z++) {
+			cellCount += countBits(cells[x][z]);
+		}
+	}
+
+	int changedCount = 0;
+	uint32_t opaqueChanged[CHUNK_SIZE][CHUNK_SIZE];		// cells of each column whose opacity changed
+	{
+		std::unique_lock<std::shared_mutex> lock(blockMutex);
+
+		// fills too large to patch are written a run of each column at a time, and the whole chunk is remeshed
+		if (ids == nullptr && cellCount > MAX_PATCHED_CELLS) {
+			for (int x = 0; x < CHUNK_SIZE; x++) {
+				for (int z = 0; z < CHUNK_SIZE; z++) {
+					uint32_t column = cells[x][z];
+					uint32_t oldOpaque = opaqueMask[x][z];
+					while (column != 0) {
+						int minY = lowestBit(column);
+						int maxY = minY;
+						while (maxY + 1 < WORLD_HEIGHT && ((column >> (maxY + 1)) & 1)) {
+							maxY++;
+						}
+						changedCount += blocks.fill(getBlockIndex(x, minY, z), getBlockIndex(x, maxY, z) + 1, fillId);
+						column &= ~((0xFFFFFFFFu >> (31 - maxY)) & (0xFFFFFFFFu << minY));
+					}
+
+					// update the column bitmasks
+					blockMask[x][z] = (fillId != BLOCK_AIR) ? blockMask[x][z] | cells[x][z] : blockMask[x][z] & ~cells[x][z];
+					opaqueMask[x][z] = Block::isOpaque(fillId) ? opaqueMask[x][z] | cells[x][z] : opaqueMask[x][z] & ~cells[x][z];
+					opaqueChanged[x][z] = oldOpaque ^ opaqueMask[x][z];
+				}
+			}
+
+			if (changedCount != 0) {
+				editedCells.clear();
+				fullRemesh = true;
+			}
+		}
+		else {
+			for (int x = 0; x < CHUNK_SIZE; x++) {
+				for (int z = 0; z < CHUNK_SIZE; z++) {
+					uint32_t oldOpaque = opaqueMask[x][z];
+					for (uint32_t column = cells[x][z]; column != 0; column &= column - 1) {
+						int y = lowestBit(column);
+						int index = getBlockIndex(x, y, z);
+						BlockId id = (ids != nullptr) ? ids[index] : fillId;
+						if (blocks.get(index) == id) {
+							continue;
+						}
+						blocks.set(index, id);
+
+						// update the column bitmasks
+						uint32_t bit = 1u << y;
+						blockMask[x][z] = (id != BLOCK_AIR) ? blockMask[x][z] | bit : blockMask[x][z] & ~bit;
+						opaqueMask[x][z] = Block::isOpaque(id) ? opaqueMask[x][z] | bit : opaqueMask[x][z] & ~bit;
+
+						addEditedCell(index);
+						changedCount++;
+					}
+					opaqueChanged[x][z] = oldOpaque ^ opaqueMask[x][z];
+				}
+			}
+		}
+
+		// set update flags once for all cells
+		if (changedCount == 0) {
+			return 0;
+		}
+		dataUpdated = false;
+		saveDirty = true;
+	}
+
+	// neighbor faces along each edge (front, right, back, left), see setBlock
+	for (int side = 0; side < 4; side++) {
+		uint32_t changed[CHUNK_SIZE];
+		uint32_t anyChanged = 0;
+		for (int i = 0; i < CHUNK_SIZE; i++) {
+			int x = (side == 1) ? CHUNK_SIZE - 1 : (side == 3) ? 0 : i;
+			int z = (side == 0) ? 0 : (side == 2) ? CHUNK_SIZE - 1 : i;
+			changed[i] = opaqueChanged[x][z];
+			anyChanged |= changed[i];
+		}
+		if (anyChanged != 0) {
+			editNeighborCells(side, changed);
+		}
+	}
+
+	return changedCount;
+}
+
+bool Chunk::hasBlock(int x, int y, int z) {
+	std::shared_lock<std::shared_mutex> lock(blockMutex);
+	return !blocks.isEmpty(getBlockIndex(x, y, z));
 }
 
-bool Chunk::isBufferUpdated() {
-	return bufferUpdated;
+bool Chunk::isOpaque(int x, int y, int z) {
+	std::shared_lock<std::shared_mutex> lock(blockMutex);
+	return Block::isOpaque(blocks.get(getBlockIndex(x, y, z)));
+}
+
+bool Chunk::isDataUpdated() {
+	return dataUpdated;
 }
 
 glm::ivec3 Chunk::getPosition() {
 	return pos;
 }
 
-unsigned int Chunk::getVaoId() {
-	// warn user if data is not up to date
-	if (!dataUpdated || !bufferUpdated) {
-		std::cout << "Warning: this chunk is not up to date" << std::endl;
-	}
+ChunkRenderState* Chunk::getRenderState() {
+	return renderState;
+}
 
-	return vaoId;
+double Chunk::getMeshTime() {
+	return meshTime;
 }
 
-int Chunk::getVertexCount() {
-	return verts.size();
+size_t Chunk::getMemoryUsage() {
+	std::shared_lock<std::shared_mutex> lock(blockMutex);
+	return blocks.getMemoryUsage() + sizeof(blocks) + sizeof(blockMask) + sizeof(opaqueMask) + sizeof(faceMasks);
 }
 
-glm::mat4 Chunk::getModelMatrix() {
-	return model;
-}
\ No newline at end of file
+void Chunk::serialize(std::vector<uint8_t>& out) {
+	std::shared_lock<std::shared_mutex> lock(blockMutex);
+	blocks.serialize(out);
+}
+
+bool Chunk::isSaveDirty() {
+	return saveDirty;
+}
+
+bool Chunk::takeSaveDirty() {
+	return saveDirty.exchange(false);
+}
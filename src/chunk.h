@@ -1,52 +1,133 @@
 #pragma once
 
-#include <map>
+#include <vector>
+#include <mutex>
+#include <shared_mutex>
+#include <atomic>
 
 #include <glm/glm.hpp>
 
 #include "block.h"
-#include "drawing.h"
+#include "block_storage.h"
+#include "vertex.h"
+#include "chunk_registry.h"
+#include "mesh_queue.h"
 
 #define CHUNK_SIZE 8		// each chunk will be a column with this length and width
 #define WORLD_HEIGHT 32		// height of the world 
+#define CHUNK_VOLUME (CHUNK_SIZE * WORLD_HEIGHT * CHUNK_SIZE)	// number of block positions in a chunk
+#define MAX_CHUNK_QUADS (CHUNK_VOLUME / 2 * FACE_COUNT)		// most quads a chunk mesh can have (every other block filled, all faces exposed)
+#define MAX_PATCHED_CELLS 64	// a meshing with more edited cells than this checks every face of the chunk instead of patching
+
+// meshing modes (see Chunk::setMeshingMode)
+#define MESHING_NAIVE 0		// one quad per exposed block face
+#define MESHING_GREEDY 1	// coplanar faces with the same sprite are merged into rectangles
+
+static_assert(WORLD_HEIGHT <= 32, "column bitmasks need one bit per y in a 32-bit mask");
+static_assert(MAX_CHUNK_QUADS * 4 <= 65536, "chunk meshes are drawn with 16-bit indices");
+static_assert(CHUNK_SIZE < 32 && WORLD_HEIGHT < 64, "chunk-local positions must fit in the PackedVertex bit fields");
+static_assert(CHUNK_SIZE * CHUNK_SIZE <= 64 && CHUNK_VOLUME <= 65536, "edited cells are tracked in a 64-bit column set and 16-bit block indices");
+
+// forward declarations
+class Benchmark;
+class ChunkRenderState;
 
 class Chunk {
-private:													// key is formatted as: (x << 16 + z), i.e. first 16 bits = x, second 16 bits = z
-	Block* blocks[CHUNK_SIZE][WORLD_HEIGHT][CHUNK_SIZE];	// pointers to all blocks in this chunk at correct position
-	Chunk* neighborChunks[4];		// pointers to surrounding chunks in order (front, right, back, left)
+private:													// key is formatted as: (x << 32 | z), i.e. first 32 bits = x, second 32 bits = z
+	// block data, written with blockMutex held exclusively and read by meshing workers with it held shared
+	BlockStorage blocks;	// palette-compressed ids of all blocks in this chunk, indexed using getBlockIndex
+	uint32_t blockMask[CHUNK_SIZE][CHUNK_SIZE];		// occupancy of each (x, z) column, bit y is set if there is a block at y
+	uint32_t opaqueMask[CHUNK_SIZE][CHUNK_SIZE];	// same as blockMask, but only for opaque blocks
+	std::vector<uint16_t> editedCells;		// block indices edited since the last meshing took them (see updateData)
+	std::shared_mutex blockMutex;		// protects the block data above
+	std::atomic<Chunk*> neighborChunks[4];		// pointers to surrounding chunks in order (front, right, back, left)
 	glm::ivec3 pos;		// position of left, front corner (lowest x, z, y always 0) along integer grid (must be multiple of CHUNK_SIZE)
-	std::vector<Vertex> verts;	// all vertices of all faces which should be drawn of blocks in this chunk
-	bool dataUpdated;		// whether or not the block faces and verts of this chunk are up-to-date
-	bool bufferUpdated;		// whether or not the buffer is up to date
-	unsigned int vaoId, bufferId;		// id of the vao that holds this chunk
-	glm::mat4 model;	// model matrix
 
-	void addFace(const Vertex* face, int x, int y, int z, int uOffset, int vOffset);	// calculate and add the vertices for this face, (x, y, z) = local position, x/y Offset = position in block spritesheet 
+	// meshing state, only used by the worker holding meshMutex
+	std::mutex meshMutex;	// makes sure only one worker meshes this chunk at a time
+	uint32_t faceMasks[FACE_COUNT][CHUNK_SIZE][CHUNK_SIZE];		// exposed faces of each column for each face (FACE_*), bit y = block at y
+	std::vector<ChunkVertex> verts;	// vertices of the mesh being built, moved into a ChunkMesh once finished (or copied, see keepVerts)
+	std::vector<uint16_t> meshCells;	// edited cells taken by the current meshing
+	bool keepVerts;		// whether or not verts keeps the last naive mesh so edits can patch it, turned on by the first edit
+	std::atomic<bool> dataUpdated;		// whether or not the block faces and verts of this chunk are up-to-date (cleared by edits)
+	std::atomic<bool> fullRemesh;	// whether or not the next meshing has to check every face (new blocks, neighbor or meshing mode changes), otherwise only the edited cells are
+	std::atomic<uint64_t> meshVersion;		// version of the newest mesh built for this chunk
+	std::atomic<unsigned int> meshedVertexCount;		// number of vertices in the newest mesh
+	std::atomic<double> meshTime;	// how long the last meshing of this chunk took (ms)
+	std::atomic<bool> saveDirty;	// whether or not the blocks were edited since the chunk was last saved (generated and loaded chunks start clean)
+
+	ChunkRenderState* renderState;		// gpu side of this chunk, created and used only by the render thread (nullptr until a mesh reaches it)
+
+	static MeshQueue finishedMeshes;	// meshes finished by workers, waiting for the render thread
+	static std::atomic<uint64_t> nextMeshVersion;		// version given to the next mesh
+	static std::atomic<int> meshingMode;		// which mesher updateData uses (MESHING_*), set by the game thread while workers mesh
+
+	void addFace(int face, glm::ivec3 pos, glm::ivec3 size, glm::ivec2 spriteOffset);	// calculate and add the vertices for a face (FACE_*) covering size blocks from local position pos, spriteOffset = position in block spritesheet
 
-	void updateBlockFaces();	// set which faces of each block are exposed
-	void updateVerts();		// update the verts vector with the correct vertices
+	Chunk(glm::ivec2 pos, bool add);	// create a chunk at the given (x, z), only added to the chunk list (and linked to its neighbors) if add is set
+
+	void linkNeighbors();	// connect this chunk and the neighbors which are in the chunk list to each other
+	void unlinkNeighbors();		// remove this chunk from its neighbors (marking them for remeshing) and forget them
+	void markFullRemesh();		// mark every face of this chunk for remeshing
+	void addEditedCell(int index);		// remember an edited block index for the next meshing, or mark the whole chunk once there are too many (blockMutex held exclusively)
+	void editNeighborCells(int side, const uint32_t changed[CHUNK_SIZE]);	// mark the cells of a neighbor (0-3) touching the changed cells of this chunk's edge column i (bit y = cell y) as edited if they have a block
+	int editBlocks(BlockId fillId, const BlockId* ids, const uint32_t cells[CHUNK_SIZE][CHUNK_SIZE]);		// see fillBlocks and pasteBlocks, ids = nullptr fills with fillId
+
+	void copyNeighborEdges(uint32_t edges[4][CHUNK_SIZE]);	// copy the opaque masks of the neighbor columns touching this chunk (front/back by x, right/left by z), 0 if there is no neighbor
+	void updateBlockFaces(const uint32_t neighborEdges[4][CHUNK_SIZE]);		// set which faces of each block are exposed, a whole column at a time using the column bitmasks
+	void updateColumnFaces(int x, int z, const uint32_t neighborEdges[4][CHUNK_SIZE]);		// same as updateBlockFaces, for the column at (x, z) only
+	void updateEditedFaces(const uint32_t neighborEdges[4][CHUNK_SIZE], bool patchVerts);	// same as updateBlockFaces, for the columns around meshCells only, and patches their faces in verts (naive meshes only)
+	void updateBlockFacesPerBlock();	// same result as updateBlockFaces, but checks every neighbor of every block (kept for benchmarking)
+	void updateHeightBounds(int& minHeight, int& maxHeight);		// find the y range containing all exposed faces from the face masks
+	void updateVerts();		// update the verts vector with the correct vertices, one quad per exposed face
+	void updateVertsGreedy();	// same as updateVerts, but merges coplanar faces with the same sprite into as few quads as possible
+	static void stageMesh(ChunkMesh* mesh);		// copy a mesh's verts into the staging ring, so the render thread only has to issue a gpu copy
+
+	friend class Benchmark;
+	friend class ChunkRenderState;
 public:
-	static std::map<uint32_t, Chunk*> chunkList;		// a list of all the chunks mapped using a key based on chunk position
-														// index is (x << 16 + z), i.e. first 16 bits are x, last 16 are z
-	static void updateChunksByNeighbor(Chunk* start);	// updates chunks in a breadth-first-search style, starting with the given node
-	static void updateAllChunks();		// updates all the chunks in the chunk list
+	static ChunkRegistry chunkList;		// a list of all the chunks mapped using a key based on chunk position, safe to use from any thread
+										// index is (x << 32 | z), i.e. first 32 bits are x, last 32 are z
+	static void updateChunksByNeighbor(Chunk* start);	// queues chunk updates on the active job system in a breadth-first-search style, starting with the given node
+	static void updateAllChunks();		// updates all the chunks in the chunk list using the active job system, and waits until they are done
+	static void submitAllChunks();		// queues an update of every chunk in the chunk list on the active job system, without waiting
+	static int getOutdatedCount();		// returns the number of chunks whose mesh is out of date
+	static void submitUpdate(Chunk* chunk);		// queues the update of a chunk on the active job system (runs it right away if there is none)
+	static void setMeshingMode(int mode);	// select the mesher (MESHING_*), all chunks are marked for remeshing
+	static int getMeshingMode();	// returns the current meshing mode
+	static void printMeshReport();		// prints the vertex count and meshing time of all chunks for the current meshing mode
 
 	static void getChunkPosition(int global, int globalZ, int& chunk, int& chunkZ);	// gets the chunk position containing the global position (x, y, z), y = anything
-	static void addBlock(std::string blockName, int x, int y, int z);	// add the given block to correct chunk at position (x, y, z) in global coords
-	static void removeBlock(int x, int y, int z);	// remove and return the block at (x, y, z) in global coords
-	static uint32_t getChunkIndex(int x, int z);	// returns the map key corresponding to this x and z
+	static void addBlock(BlockId id, int x, int y, int z);	// add the given block to correct chunk at position (x, y, z) in global coords, the chunk has to be saved afterwards
+	static void addBlock(std::string blockName, int x, int y, int z);	// same as above, but looks up the id of the block name first
+	static void removeBlock(int x, int y, int z);	// remove and return the block at (x, y, z) in global coords, the chunk has to be saved afterwards
+	static void removeChunk(int x, int z);		// remove the chunk at (x, z), it is deleted once no thread can still be using it
+	static ChunkKey getChunkIndex(int x, int z);	// returns the map key corresponding to this x and z
+	static int getBlockIndex(int x, int y, int z);	// returns the storage index of local position (x, y, z), each (x, z) column is contiguous
+	static void printMemoryReport();	// prints the block memory used by all chunks compared to one heap Block per solid position
 
-	Chunk(glm::ivec2 pos);	// create a chunk at the given (x, z)
+	static Chunk* create(glm::ivec2 pos, bool& inserted);	// create and add the chunk at (x, z), or return the chunk already there if another thread added it first (inserted = false), the caller must hold an EpochGuard
+
+	Chunk(glm::ivec2 pos);	// create a chunk at the given (x, z) and add it to the chunk list (use create if another thread may add it too)
 	~Chunk();
 
+	BlockId getBlock(int x, int y, int z);	// returns the id of the block at local position (x, y, z), BLOCK_AIR if there is none (takes blockMutex shared, like hasBlock and isOpaque)
+	void setBlock(BlockId id, int x, int y, int z);	// sets the block at local position (x, y, z), BLOCK_AIR removes it
+	void setBlocks(const BlockId* ids);		// replaces every block of this chunk, ids holds CHUNK_VOLUME ids in block index order
+	int fillBlocks(BlockId id, const uint32_t cells[CHUNK_SIZE][CHUNK_SIZE]);	// sets the cells of each local column (x, z) whose bit y is set to id with one lock, marks the chunk for remeshing and saving once, returns the number of blocks changed
+	int pasteBlocks(const BlockId* ids, const uint32_t cells[CHUNK_SIZE][CHUNK_SIZE]);		// same as fillBlocks, but each cell gets its id from ids (CHUNK_VOLUME ids in block index order)
+	bool hasBlock(int x, int y, int z);		// whether or not there is a block at local position (x, y, z)
+	bool isOpaque(int x, int y, int z);		// whether or not the block at local position (x, y, z) hides its neighbors' faces
+
 	void addNeighbor(Chunk* chunk);		// add a neighboring chunk
-	void updateData();		// update the block faces and vertices of this chunk
-	void updateBuffer();		// update this chunk's buffer
+	void updateData();		// mesh this chunk and queue the mesh for the render thread (any thread)
 	bool isDataUpdated();	// whether or not the face/vertex data of this chunk is up to date
-	bool isBufferUpdated();	// whether or not the buffer is up to date
 
 	glm::ivec3 getPosition();	// returns the position of this chunk
-	unsigned int getVaoId();		// return the vertices array
-	int getVertexCount();		// returns the total number of vertices of this chunk's vao
-	glm::mat4 getModelMatrix();		// returns this chunk's model matrix
+	ChunkRenderState* getRenderState();		// returns the gpu side of this chunk, nullptr if no mesh has reached the render thread yet (render thread only)
+	double getMeshTime();		// returns how long the last meshing of this chunk took (ms)
+	size_t getMemoryUsage();	// returns the number of bytes used by this chunk's block data
+	void serialize(std::vector<uint8_t>& out);		// appends the chunk's serialized block storage to out (any thread)
+	bool isSaveDirty();		// whether or not the blocks were edited since the chunk was last saved
+	bool takeSaveDirty();	// clears the save dirty flag, returns whether or not it was set (the caller saves the chunk if so)
 };
\ No newline at end of file
@@ -0,0 +1,191 @@
+#include "chunk_registry.h"
+#include "epoch.h"
+
+ChunkRegistry::Table::Table(size_t capacity) : mask(capacity - 1), slots(new Slot[capacity]) {
+	for (size_t i = 0; i < capacity; i++) {
+		slots[i].key = CHUNK_KEY_EMPTY;
+		slots[i].chunk = nullptr;
+	}
+}
+
+ChunkRegistry::Table::~Table() {
+	delete[] slots;
+}
+
+ChunkRegistry::ChunkRegistry() {
+	for (Shard& shard : shards) {
+		shard.table = new Table(CHUNK_REGISTRY_MIN_SLOTS);
+		shard.count = 0;
+		shard.usedSlots = 0;
+	}
+}
+
+ChunkRegistry::~ChunkRegistry() {
+	for (Shard& shard : shards) {
+		delete shard.table.load();
+	}
+}
+
+uint64_t ChunkRegistry::hash(ChunkKey key) {
+	// murmur3 finalizer, neighboring chunks end up far apart
+	key ^= key >> 33;
+	key *= 0xff51afd7ed558ccdULL;
+	key ^= key >> 33;
+	key *= 0xc4ceb9fe1a85ec53ULL;
+	key ^= key >> 33;
+
+	return key;
+}
+
+ChunkRegistry::Shard& ChunkRegistry::getShard(uint64_t hash) {
+	return shards[(hash >> 58) % CHUNK_REGISTRY_SHARDS];
+}
+
+void ChunkRegistry::rebuild(Shard& shard, size_t capacity) {
+	Table* old = shard.table.load();
+	Table* table = new Table(capacity);
+
+	// copy the chunks, removed entries are dropped
+	for (size_t i = 0; i <= old->mask; i++) {
+		ChunkKey key = old->slots[i].key;
+		Chunk* chunk = old->slots[i].chunk;
+		if (key == CHUNK_KEY_EMPTY || key == CHUNK_KEY_REMOVED || chunk == nullptr) {
+			continue;
+		}
+
+		size_t index = hash(key) & table->mask;
+		while (table->slots[index].key != CHUNK_KEY_EMPTY) {
+			index = (index + 1) & table->mask;
+		}
+		table->slots[index].chunk = chunk;
+		table->slots[index].key = key;
+	}
+	shard.usedSlots = shard.count;
+
+	// readers may still be searching the old table
+	shard.table = table;
+	Epoch::retire([old] { delete old; });
+}
+
+Chunk* ChunkRegistry::find(ChunkKey key) {
+	EpochGuard guard;
+
+	uint64_t keyHash = hash(key);
+	Table* table = getShard(keyHash).table.load();
+
+	// probe until the key or an empty slot, removed slots are skipped
+	for (size_t index = keyHash & table->mask;; index = (index + 1) & table->mask) {
+		Slot& slot = table->slots[index];
+		ChunkKey slotKey = slot.key.load();
+		if (slotKey == CHUNK_KEY_EMPTY) {
+			return nullptr;
+		}
+		if (slotKey == key) {
+			// the slot could be removed and reused between reading the key and the chunk, so the key is checked again
+			Chunk* chunk = slot.chunk.load();
+			if (slot.key.load() == key) {
+				return chunk;
+			}
+		}
+	}
+}
+
+bool ChunkRegistry::insert(ChunkKey key, Chunk* chunk, Chunk** existing) {
+	uint64_t keyHash = hash(key);
+	Shard& shard = getShard(keyHash);
+	std::lock_guard<std::mutex> lock(shard.writeMutex);
+
+	// make room first, doubling the size only if most used slots hold chunks (otherwise clearing removed entries is enough)
+	Table* table = shard.table.load();
+	if (shard.usedSlots + 1 > (table->mask + 1) * CHUNK_REGISTRY_MAX_LOAD) {
+		size_t capacity = table->mask + 1;
+		if (shard.count + 1 > capacity * CHUNK_REGISTRY_MAX_LOAD / 2) {
+			capacity *= 2;
+		}
+		rebuild(shard, capacity);
+		table = shard.table.load();
+	}
+
+	// look for the key, remembering the first removed slot to reuse
+	Slot* target = nullptr;
+	size_t index = keyHash & table->mask;
+	for (;; index = (index + 1) & table->mask) {
+		ChunkKey slotKey = table->slots[index].key;
+		if (slotKey == key) {
+			if (existing != nullptr) {
+				*existing = table->slots[index].chunk;
+			}
+			return false;
+		}
+		if (slotKey == CHUNK_KEY_REMOVED && target == nullptr) {
+			target = &table->slots[index];
+		}
+		if (slotKey == CHUNK_KEY_EMPTY) {
+			break;
+		}
+	}
+	if (target == nullptr) {
+		target = &table->slots[index];
+		shard.usedSlots++;
+	}
+
+	target->chunk = chunk;
+	target->key = key;
+	shard.count++;
+
+	return true;
+}
+
+Chunk* ChunkRegistry::erase(ChunkKey key, Chunk* expected) {
+	uint64_t keyHash = hash(key);
+	Shard& shard = getShard(keyHash);
+	std::lock_guard<std::mutex> lock(shard.writeMutex);
+
+	Table* table = shard.table.load();
+	for (size_t index = keyHash & table->mask;; index = (index + 1) & table->mask) {
+		Slot& slot = table->slots[index];
+		ChunkKey slotKey = slot.key;
+		if (slotKey == CHUNK_KEY_EMPTY) {
+			return nullptr;
+		}
+		if (slotKey != key) {
+			continue;
+		}
+
+		Chunk* chunk = slot.chunk;
+		if (expected != nullptr && chunk != expected) {
+			return nullptr;
+		}
+
+		// the slot stays used so probes for other keys continue past it
+		slot.key = CHUNK_KEY_REMOVED;
+		slot.chunk = nullptr;
+		shard.count--;
+
+		return chunk;
+	}
+}
+
+void ChunkRegistry::getAll(std::vector<Chunk*>& chunks) {
+	EpochGuard guard;
+
+	for (Shard& shard : shards) {
+		Table* table = shard.table.load();
+		for (size_t i = 0; i <= table->mask; i++) {
+			ChunkKey key = table->slots[i].key;
+			Chunk* chunk = table->slots[i].chunk;
+			if (key != CHUNK_KEY_EMPTY && key != CHUNK_KEY_REMOVED && chunk != nullptr) {
+				chunks.push_back(chunk);
+			}
+		}
+	}
+}
+
+size_t ChunkRegistry::size() {
+	size_t count = 0;
+	for (Shard& shard : shards) {
+		count += shard.count;
+	}
+
+	return count;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+
+#define CHUNK_REGISTRY_SHARDS 16	// number of independently locked parts of the chunk registry
+#define CHUNK_REGISTRY_MIN_SLOTS 64		// initial number of slots in each shard's table (power of 2)
+#define CHUNK_REGISTRY_MAX_LOAD 0.7		// a table is rebuilt once this fraction of its slots is used (including removed entries)
+
+#define CHUNK_KEY_EMPTY UINT64_MAX		// key of a slot which was never used
+#define CHUNK_KEY_REMOVED (UINT64_MAX - 1)		// key of a slot whose chunk was removed
+
+typedef uint64_t ChunkKey;	// chunk position packed as (x << 32) | z, both as 32-bit two's complement
+
+// forward declarations
+class Chunk;
+
+// map from chunk key to chunk which many threads can use at once
+// keys are spread over shards, each shard is a flat open-addressing table (linear probing) which readers search without locking
+// writers change slots in place under the shard's lock, and rebuild the table when it gets too full, publishing the new one and retiring the old one through Epoch
+// lookups guard the table themselves, but callers must hold an EpochGuard for as long as they use a chunk they got from the registry
+class ChunkRegistry {
+private:
+	// one entry of a table, the chunk is written before the key so readers which see the key also see the chunk
+	struct Slot {
+		std::atomic<ChunkKey> key;
+		std::atomic<Chunk*> chunk;
+	};
+
+	// a table of a shard, replaced as a whole when it is rebuilt
+	struct Table {
+		size_t mask;	// number of slots minus one
+		Slot* slots;
+
+		Table(size_t capacity);
+		~Table();
+	};
+
+	// one shard, padded so writers to different shards don't share cache lines
+	struct alignas(64) Shard {
+		std::mutex writeMutex;		// serializes writers of this shard
+		std::atomic<Table*> table;	// current table of this shard
+		std::atomic<size_t> count;		// number of chunks in this shard
+		size_t usedSlots;		// number of slots which aren't empty (chunks and removed entries), only used by writers
+	};
+
+	Shard shards[CHUNK_REGISTRY_SHARDS];
+
+	static uint64_t hash(ChunkKey key);		// mixes the bits of a key, the top bits pick the shard and the bottom bits the first slot
+	Shard& getShard(uint64_t hash);		// returns the shard of a hashed key
+	void rebuild(Shard& shard, size_t capacity);	// moves a shard's chunks into a new table and retires the old one, writeMutex must be held
+public:
+	ChunkRegistry();
+	~ChunkRegistry();
+
+	Chunk* find(ChunkKey key);		// returns the chunk with the given key, nullptr if there is none
+	bool insert(ChunkKey key, Chunk* chunk, Chunk** existing = nullptr);	// adds a chunk, returns false if the key is already used (and the chunk using it in existing, if given)
+	Chunk* erase(ChunkKey key, Chunk* expected = nullptr);		// removes and returns the chunk with the given key (only if it is expected, when given)
+	void getAll(std::vector<Chunk*>& chunks);	// appends every chunk to chunks
+	size_t size();		// returns the number of chunks
+};
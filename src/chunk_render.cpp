@@ -0,0 +1,125 @@
+#include "chunk_render.h"
+#include "chunk.h"
+#include "mesh_pool.h"
+#include "epoch.h"
+#include "profiler.h"
+
+void ChunkRenderState::receiveMeshes() {
+	PROFILE_ZONE("ChunkRenderState::receiveMeshes");
+
+	EpochGuard guard;
+
+	ChunkMesh* newMesh;
+	while ((newMesh = Chunk::finishedMeshes.pop()) != nullptr) {
+		// meshes of removed chunks, and meshes replaced by a newer one, are dropped
+		Chunk* chunk = Chunk::chunkList.find(newMesh->key);
+		if (chunk == nullptr || newMesh->version != chunk->meshVersion) {
+			delete newMesh;
+			continue;
+		}
+
+		if (chunk->renderState == nullptr) {
+			chunk->renderState = new ChunkRenderState();
+		}
+		chunk->renderState->setPendingMesh(newMesh);
+	}
+}
+
+ChunkRenderState::ChunkRenderState() : pendingMesh(nullptr), pendingFrames(0), mesh(), vertexCount(0), minHeight(0), maxHeight(0) {}
+
+ChunkRenderState::~ChunkRenderState() {
+	MeshPool::release(mesh);
+	delete pendingMesh;
+}
+
+void ChunkRenderState::setPendingMesh(ChunkMesh* newMesh) {
+	// a mesh which was never uploaded is replaced (and its staging region given up)
+	delete pendingMesh;
+	pendingMesh = newMesh;
+	pendingFrames = 0;
+}
+
+void ChunkRenderState::upload() {
+	PROFILE_ZONE("ChunkRenderState::upload");
+
+	// if buffer is up to date, do nothing
+	if (pendingMesh == nullptr) {
+		return;
+	}
+
+	std::vector<ChunkVertex>& newVerts = pendingMesh->verts;
+	if (newVerts.empty()) {
+		// nothing left to draw
+		MeshPool::release(mesh);
+		vertexCount = 0;
+	}
+	else {
+		// get a new range in the mesh pool if the mesh doesn't fit in the old one
+		if (mesh.arena < 0 || newVerts.size() * sizeof(ChunkVertex) > mesh.size) {
+			MeshPool::release(mesh);
+			vertexCount = 0;
+			if (!MeshPool::allocate(newVerts.size(), mesh)) {
+				return;
+			}
+		}
+
+		// copy the staged mesh on the gpu if it was staged, otherwise upload verts directly
+		if (pendingMesh->staged.data != nullptr) {
+			MeshPool::uploadStaged(mesh, pendingMesh->staged);
+		}
+		else {
+			MeshPool::upload(mesh, &newVerts[0], newVerts.size());
+		}
+		vertexCount = newVerts.size();
+	}
+
+	// the uploaded mesh is the one drawn from now on
+	minHeight = pendingMesh->minHeight;
+	maxHeight = pendingMesh->maxHeight;
+	delete pendingMesh;
+	pendingMesh = nullptr;
+}
+
+void ChunkRenderState::waitFrame() {
+	if (pendingMesh == nullptr || pendingMesh->staged.data == nullptr) {
+		return;
+	}
+
+	// the ring frees regions in order, so a region held by a chunk which stays out of view (or behind the upload budget) would keep
+	// every region after it from being reused
+	if (++pendingFrames > STAGING_MAX_WAIT_FRAMES) {
+		StagingRing::discard(pendingMesh->staged);
+	}
+}
+
+size_t ChunkRenderState::getUploadSize() {
+	if (pendingMesh == nullptr) {
+		return 0;
+	}
+
+	return pendingMesh->verts.size() * sizeof(ChunkVertex);
+}
+
+bool ChunkRenderState::isUploaded() {
+	return pendingMesh == nullptr;
+}
+
+GpuAllocation ChunkRenderState::getMesh() {
+	return mesh;
+}
+
+int ChunkRenderState::getVertexCount() {
+	return vertexCount;
+}
+
+int ChunkRenderState::getIndexCount() {
+	return vertexCount / 4 * 6;
+}
+
+int ChunkRenderState::getMinHeight() {
+	return (pendingMesh != nullptr) ? pendingMesh->minHeight : minHeight;
+}
+
+int ChunkRenderState::getMaxHeight() {
+	return (pendingMesh != nullptr) ? pendingMesh->maxHeight : maxHeight;
+}
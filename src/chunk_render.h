@@ -0,0 +1,35 @@
+#pragma once
+
+#include "gpu_allocator.h"
+#include "mesh_queue.h"
+
+#define STAGING_MAX_WAIT_FRAMES 8	// frames a pending mesh may keep its staging region before giving it up (it's then uploaded directly)
+
+// gpu side of a chunk: its range in the mesh pool and the newest mesh waiting to be uploaded
+// only the render thread uses it, and it is only created once a mesh of the chunk reaches the render thread,
+// so chunks can be created, generated and meshed on any thread without the opengl context
+class ChunkRenderState {
+private:
+	ChunkMesh* pendingMesh;		// newest finished mesh which hasn't been uploaded yet (nullptr if none)
+	int pendingFrames;		// number of frames the pending mesh has been waiting for its upload
+	GpuAllocation mesh;		// range of the chunk's mesh in the mesh pool (arena = -1 if none)
+	unsigned int vertexCount;		// number of vertices uploaded to the mesh pool
+	int minHeight, maxHeight;	// y range [min, max) which contains all faces of the uploaded mesh, used for culling
+public:
+	static void receiveMeshes();	// hands the meshes finished since the last call to their chunks' render states, creating them as needed
+
+	ChunkRenderState();
+	~ChunkRenderState();	// returns the mesh pool range and drops the pending mesh
+
+	void setPendingMesh(ChunkMesh* newMesh);	// replaces the mesh waiting to be uploaded
+	void upload();		// uploads the pending mesh, if there is one
+	void waitFrame();	// counts a frame the pending mesh wasn't uploaded in, and gives up its staging region once it waited too long
+	size_t getUploadSize();		// returns the number of bytes upload will copy (0 if there is nothing to upload)
+	bool isUploaded();		// whether or not the newest received mesh has been uploaded
+
+	GpuAllocation getMesh();		// returns the range of the chunk's mesh in the mesh pool
+	int getVertexCount();		// returns the number of vertices of the uploaded mesh
+	int getIndexCount();	// returns the number of indices needed to draw the uploaded mesh (6 per quad)
+	int getMinHeight();		// returns the lowest y with an exposed face (in the mesh which is or is about to be uploaded)
+	int getMaxHeight();		// returns one more than the highest y with an exposed face
+};
@@ -0,0 +1,367 @@
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+
+#include "chunk_streamer.h"
+#include "terrain.h"
+#include "camera.h"
+#include "job_system.h"
+#include "epoch.h"
+#include "world_storage.h"
+#include "profiler.h"
+
+TerrainGenerator* ChunkStreamer::generator = nullptr;
+int ChunkStreamer::loadRadius = STREAM_LOAD_RADIUS;
+int ChunkStreamer::unloadRadius = STREAM_LOAD_RADIUS + STREAM_UNLOAD_MARGIN;
+bool ChunkStreamer::hasCenter = false;
+glm::ivec2 ChunkStreamer::center = glm::ivec2(0, 0);
+glm::vec3 ChunkStreamer::cameraPos = glm::vec3(0, 0, 0);
+glm::vec3 ChunkStreamer::cameraForward = glm::vec3(0, 0, -1);
+glm::vec3 ChunkStreamer::sortedPos = glm::vec3(0, 0, 0);
+glm::vec3 ChunkStreamer::sortedForward = glm::vec3(0, 0, -1);
+std::deque<glm::ivec2> ChunkStreamer::waiting = std::deque<glm::ivec2>();
+std::map<ChunkKey, ChunkStreamer::GeneratedChunk*> ChunkStreamer::generating = std::map<ChunkKey, ChunkStreamer::GeneratedChunk*>();
+std::deque<ChunkStreamer::GeneratedChunk*> ChunkStreamer::ready = std::deque<ChunkStreamer::GeneratedChunk*>();
+std::deque<glm::ivec2> ChunkStreamer::meshWaiting = std::deque<glm::ivec2>();
+std::set<ChunkKey> ChunkStreamer::meshQueued = std::set<ChunkKey>();
+std::atomic<int> ChunkStreamer::meshing(0);
+std::mutex ChunkStreamer::finishedMutex;
+std::vector<ChunkStreamer::GeneratedChunk*> ChunkStreamer::finished = std::vector<ChunkStreamer::GeneratedChunk*>();
+
+void ChunkStreamer::init(TerrainGenerator* terrain) {
+	generator = terrain;
+	hasCenter = false;
+}
+
+void ChunkStreamer::setLoadRadius(int radius) {
+	if (radius < 1) {
+		std::cerr << "Invalid load radius " << radius << " given, using 1." << std::endl;
+		radius = 1;
+	}
+
+	loadRadius = radius;
+	unloadRadius = radius + STREAM_UNLOAD_MARGIN;
+
+	// check every chunk again on the next update
+	hasCenter = false;
+}
+
+bool ChunkStreamer::isInRadius(int chunkX, int chunkZ, int radius) {
+	int dx = (chunkX - center.x) / CHUNK_SIZE;
+	int dz = (chunkZ - center.y) / CHUNK_SIZE;
+	return dx * dx + dz * dz <= radius * radius;
+}
+
+float ChunkStreamer::getPriority(int chunkX, int chunkZ) {
+	// horizontal distance from the camera to the middle of the chunk
+	glm::vec2 toChunk = glm::vec2(chunkX + CHUNK_SIZE / 2.0f - cameraPos.x, chunkZ + CHUNK_SIZE / 2.0f - cameraPos.z);
+	float distance = glm::length(toChunk);
+
+	// no direction to weigh by if the chunk is right below the camera or the camera looks straight up or down
+	glm::vec2 forward = glm::vec2(cameraForward.x, cameraForward.z);
+	if (distance < 0.001f || glm::length(forward) < 0.001f) {
+		return distance;
+	}
+
+	// chunks further from the view direction count as further away
+	float cosAngle = glm::dot(toChunk / distance, glm::normalize(forward));
+	return distance * (1 + STREAM_ANGLE_WEIGHT * (1 - cosAngle) / 2);
+}
+
+void ChunkStreamer::queueMissingChunks() {
+	waiting.clear();
+
+	// every chunk in the load radius which isn't loaded or on its way
+	for (int dx = -loadRadius; dx <= loadRadius; dx++) {
+		for (int dz = -loadRadius; dz <= loadRadius; dz++) {
+			int x = center.x + dx * CHUNK_SIZE;
+			int z = center.y + dz * CHUNK_SIZE;
+			ChunkKey key = Chunk::getChunkIndex(x, z);
+			if (isInRadius(x, z, loadRadius) && generating.find(key) == generating.end() && Chunk::chunkList.find(key) == nullptr) {
+				waiting.push_back(glm::ivec2(x, z));
+			}
+		}
+	}
+}
+
+void ChunkStreamer::cancelFarChunks() {
+	// the workers skip cancelled chunks, and update drops them once they come back
+	for (std::pair<const ChunkKey, GeneratedChunk*>& entry : generating) {
+		entry.second->cancelled = !isInRadius(entry.second->x, entry.second->z, loadRadius);
+	}
+}
+
+void ChunkStreamer::unloadFarChunks(StreamStats& stats) {
+	// edited far chunks are snapshotted for the save thread before they are removed, the others can be generated again
+	WorldStorage* storage = WorldStorage::getActive();
+	std::vector<glm::ivec2> farChunks;
+	{
+		EpochGuard guard;
+		std::vector<Chunk*> chunks;
+		Chunk::chunkList.getAll(chunks);
+		for (Chunk* chunk : chunks) {
+			glm::ivec3 pos = chunk->getPosition();
+			if (!isInRadius(pos.x, pos.z, unloadRadius)) {
+				farChunks.push_back(glm::ivec2(pos.x, pos.z));
+				if (storage != nullptr) {
+					storage->queueSave(chunk);
+				}
+			}
+		}
+	}
+
+	// the blocks and gpu buffers are freed once no thread can still be using the chunks (see Epoch::collect)
+	for (glm::ivec2 pos : farChunks) {
+		Chunk::removeChunk(pos.x, pos.y);
+		stats.unloaded++;
+	}
+	for (glm::ivec2 pos : farChunks) {
+		queueNeighborMeshes(pos.x, pos.y);
+	}
+}
+
+bool ChunkStreamer::loadChunk(GeneratedChunk* generated) {
+	ChunkKey key = Chunk::getChunkIndex(generated->x, generated->z);
+
+	// an edit could have created the chunk in the meantime, it is kept as it is
+	EpochGuard guard;
+	if (Chunk::chunkList.find(key) != nullptr) {
+		return false;
+	}
+
+	// another thread can still add it first, then that chunk is kept as well
+	bool inserted;
+	Chunk* chunk = Chunk::create(glm::ivec2(generated->x, generated->z), inserted);
+	if (!inserted) {
+		return false;
+	}
+
+	chunk->setBlocks(generated->ids);
+	queueMesh(generated->x, generated->z);
+	queueNeighborMeshes(generated->x, generated->z);
+	return true;
+}
+
+void ChunkStreamer::queueMesh(int chunkX, int chunkZ) {
+	if (meshQueued.insert(Chunk::getChunkIndex(chunkX, chunkZ)).second) {
+		meshWaiting.push_back(glm::ivec2(chunkX, chunkZ));
+	}
+}
+
+void ChunkStreamer::queueNeighborMeshes(int chunkX, int chunkZ) {
+	const glm::ivec2 offsets[4] = { glm::ivec2(0, -CHUNK_SIZE), glm::ivec2(CHUNK_SIZE, 0), glm::ivec2(0, CHUNK_SIZE), glm::ivec2(-CHUNK_SIZE, 0) };
+
+	EpochGuard guard;
+	for (glm::ivec2 offset : offsets) {
+		Chunk* neighbor = Chunk::chunkList.find(Chunk::getChunkIndex(chunkX + offset.x, chunkZ + offset.y));
+		if (neighbor != nullptr && !neighbor->isDataUpdated()) {
+			queueMesh(chunkX + offset.x, chunkZ + offset.y);
+		}
+	}
+}
+
+void ChunkStreamer::sortQueues() {
+	// priorities are worked out once per entry, not once per comparison
+	std::vector<std::pair<float, glm::ivec2>> entries;
+	for (std::deque<glm::ivec2>* queue : { &waiting, &meshWaiting }) {
+		entries.clear();
+		for (glm::ivec2 pos : *queue) {
+			entries.push_back(std::make_pair(getPriority(pos.x, pos.y), pos));
+		}
+		std::stable_sort(entries.begin(), entries.end(), [](const std::pair<float, glm::ivec2>& a, const std::pair<float, glm::ivec2>& b) {
+			return a.first < b.first;
+		});
+
+		queue->clear();
+		for (std::pair<float, glm::ivec2>& entry : entries) {
+			queue->push_back(entry.second);
+		}
+	}
+
+	std::stable_sort(ready.begin(), ready.end(), [](GeneratedChunk* a, GeneratedChunk* b) {
+		return getPriority(a->x, a->z) < getPriority(b->x, b->z);
+	});
+
+	sortedPos = cameraPos;
+	sortedForward = cameraForward;
+}
+
+StreamStats ChunkStreamer::update(Camera* camera) {
+	PROFILE_ZONE("ChunkStreamer::update");
+
+	StreamStats stats;
+	if (generator == nullptr || camera == nullptr) {
+		return stats;
+	}
+
+	cameraPos = camera->getPosition();
+	cameraForward = camera->getForward();
+	Frustum frustum = Frustum(camera->getMatrix());
+
+	// the loaded area only changes when the camera enters another chunk
+	glm::ivec2 newCenter;
+	Chunk::getChunkPosition((int) std::floor(cameraPos.x), (int) std::floor(cameraPos.z), newCenter.x, newCenter.y);
+	bool resort = !hasCenter || newCenter != center;
+	if (resort) {
+		center = newCenter;
+		hasCenter = true;
+		cancelFarChunks();
+		unloadFarChunks(stats);
+		queueMissingChunks();
+	}
+
+	// collect the chunks the workers have finished
+	{
+		std::lock_guard<std::mutex> lock(finishedMutex);
+		resort = resort || !finished.empty();
+		ready.insert(ready.end(), finished.begin(), finished.end());
+		finished.clear();
+	}
+
+	// the order changes as the camera moves and turns
+	resort = resort || glm::distance(cameraPos, sortedPos) > STREAM_RESORT_DISTANCE || glm::dot(cameraForward, sortedForward) < STREAM_RESORT_ANGLE;
+	if (resort) {
+		sortQueues();
+	}
+
+	// add a limited number of them to the world, unless they have left the load radius
+	while (!ready.empty() && stats.loaded < STREAM_MAX_LOADS) {
+		GeneratedChunk* generated = ready.front();
+		ready.pop_front();
+		generating.erase(Chunk::getChunkIndex(generated->x, generated->z));
+
+		if (!isInRadius(generated->x, generated->z, loadRadius)) {
+			stats.cancelled++;
+		}
+		else if (generated->skipped) {
+			// came back into the load radius after the worker skipped it
+			waiting.push_front(glm::ivec2(generated->x, generated->z));
+		}
+		else if (loadChunk(generated)) {
+			stats.loaded++;
+			stats.loadedFromDisk += generated->fromDisk;
+		}
+		else {
+			stats.discarded++;
+		}
+		delete generated;
+	}
+
+	// keep a limited number of chunks generating
+	JobSystem* jobs = JobSystem::getActive();
+	while (!waiting.empty() && (int) (generating.size() - ready.size()) < STREAM_MAX_GENERATING) {
+		glm::ivec2 pos = waiting.front();
+		waiting.pop_front();
+
+		ChunkKey key = Chunk::getChunkIndex(pos.x, pos.y);
+		if (generating.find(key) != generating.end() || Chunk::chunkList.find(key) != nullptr) {
+			continue;
+		}
+
+		GeneratedChunk* generated = new GeneratedChunk();
+		generated->x = pos.x;
+		generated->z = pos.y;
+		generated->cancelled = false;
+		generated->skipped = false;
+		generated->fromDisk = false;
+		generating[key] = generated;
+
+		// saved chunks are loaded, the rest are generated
+		TerrainGenerator* terrain = generator;
+		WorldStorage* storage = WorldStorage::getActive();
+		Job job = [terrain, storage, generated] {
+			generated->skipped = generated->cancelled;
+			if (!generated->skipped) {
+				generated->fromDisk = storage != nullptr && storage->loadChunk(generated->x, generated->z, generated->ids);
+				if (!generated->fromDisk) {
+					terrain->generateBlocks(generated->x, generated->z, generated->ids);
+				}
+			}
+
+			std::lock_guard<std::mutex> lock(finishedMutex);
+			finished.push_back(generated);
+		};
+
+		if (jobs != nullptr) {
+			jobs->submit(job);
+		}
+		else {
+			job();
+		}
+	}
+
+	// keep a limited number of chunks meshing, chunks which are unloaded before their job runs are skipped by it
+	while (!meshWaiting.empty() && meshing < STREAM_MAX_MESHING) {
+		glm::ivec2 pos = meshWaiting.front();
+		meshWaiting.pop_front();
+
+		ChunkKey key = Chunk::getChunkIndex(pos.x, pos.y);
+		meshQueued.erase(key);
+
+		meshing++;
+		Job job = [key] {
+			{
+				EpochGuard guard;
+				Chunk* chunk = Chunk::chunkList.find(key);
+				if (chunk != nullptr) {
+					chunk->updateData();
+				}
+			}
+			meshing--;
+		};
+
+		if (jobs != nullptr) {
+			jobs->submit(job);
+		}
+		else {
+			job();
+		}
+	}
+
+	// chunks in view which the player is still waiting for
+	for (glm::ivec2 pos : waiting) {
+		if (frustum.intersectsBox(glm::vec3(pos.x, 0, pos.y), glm::vec3(pos.x + CHUNK_SIZE, WORLD_HEIGHT, pos.y + CHUNK_SIZE))) {
+			stats.waitingInView++;
+		}
+	}
+	for (std::pair<const ChunkKey, GeneratedChunk*>& entry : generating) {
+		glm::vec3 boxMin = glm::vec3(entry.second->x, 0, entry.second->z);
+		if (!entry.second->cancelled && frustum.intersectsBox(boxMin, boxMin + glm::vec3(CHUNK_SIZE, WORLD_HEIGHT, CHUNK_SIZE))) {
+			stats.waitingInView++;
+		}
+	}
+
+	stats.waiting = waiting.size();
+	stats.generating = generating.size() - ready.size();
+	stats.ready = ready.size();
+	stats.meshWaiting = meshWaiting.size();
+	stats.meshing = meshing;
+	stats.chunks = Chunk::chunkList.size();
+	return stats;
+}
+
+void ChunkStreamer::clear() {
+	{
+		std::lock_guard<std::mutex> lock(finishedMutex);
+		ready.insert(ready.end(), finished.begin(), finished.end());
+		finished.clear();
+	}
+
+	for (GeneratedChunk* generated : ready) {
+		delete generated;
+	}
+	ready.clear();
+	waiting.clear();
+	generating.clear();
+	meshWaiting.clear();
+	meshQueued.clear();
+	hasCenter = false;
+}
+
+int ChunkStreamer::getLoadRadius() {
+	return loadRadius;
+}
+
+int ChunkStreamer::getUnloadRadius() {
+	return unloadRadius;
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <map>
+#include <set>
+#include <mutex>
+#include <atomic>
+
+#include <glm/glm.hpp>
+
+#include "chunk.h"
+
+#define STREAM_LOAD_RADIUS 12		// chunks whose center is within this many chunks of the camera's chunk are loaded
+#define STREAM_UNLOAD_MARGIN 2		// chunks are unloaded once they are this many chunks further out than the load radius
+#define STREAM_MAX_GENERATING 32	// most chunks being generated by workers at once
+#define STREAM_MAX_MESHING 32		// most chunks being meshed by workers for the streamer at once
+#define STREAM_MAX_LOADS 16		// most generated chunks added to the world per frame
+#define STREAM_ANGLE_WEIGHT 3.0f	// a chunk straight behind the camera is treated as (1 + this) times further away than one straight ahead
+#define STREAM_RESORT_DISTANCE 2.0f		// the queues are sorted again once the camera has moved this far (blocks) since the last sort
+#define STREAM_RESORT_ANGLE 0.996f		// or once the cosine of the angle the camera has turned by since the last sort drops below this (about 5 degrees)
+
+// forward declarations
+class TerrainGenerator;
+class Camera;
+
+// chunk loading and unloading done by ChunkStreamer::update, plus its queue depths
+struct StreamStats {
+	int loaded;		// number of chunks added to the world
+	int loadedFromDisk;		// number of the added chunks which were loaded from the world storage instead of generated
+	int unloaded;	// number of chunks removed from the world
+	int cancelled;		// number of chunks dropped because they left the load radius before they were added
+	int discarded;		// number of generated chunks thrown away because an edit created the chunk first
+	int waiting;	// number of chunks in the load radius which haven't been given to a worker yet
+	int generating;		// number of chunks being generated by workers
+	int ready;		// number of generated chunks waiting to be added to the world
+	int meshWaiting;	// number of loaded chunks waiting to be given to a worker for meshing
+	int meshing;	// number of chunks being meshed by workers for the streamer
+	int waitingInView;		// number of chunks inside the camera's view which aren't loaded yet
+	size_t chunks;		// number of chunks in the world
+
+	StreamStats() : loaded(0), loadedFromDisk(0), unloaded(0), cancelled(0), discarded(0), waiting(0), generating(0), ready(0), meshWaiting(0), meshing(0), waitingInView(0), chunks(0) {}
+};
+
+// keeps the chunks around the camera loaded: missing chunks in the load radius are loaded from the active world storage (or generated
+// if they were never saved) on the active job system and added to the world once finished, chunks outside the unload radius are removed (and queued
+// for saving if they were edited)
+// generation, meshing of new chunks and mesh uploads (see drawChunks) go in priority order: nearest first, with chunks the camera is
+// looking towards ahead of those behind it, and the queues are sorted again as the camera moves and turns
+// the number of chunks in flight and added per frame is capped, so the work per frame stays bounded wherever the camera goes
+class ChunkStreamer {
+private:
+	// blocks of a chunk generated by a worker
+	struct GeneratedChunk {
+		int x, z;
+		std::atomic<bool> cancelled;	// set while the chunk is outside the load radius, the worker then skips it
+		bool skipped;	// whether or not the worker skipped the chunk, so ids was never filled
+		bool fromDisk;		// whether or not ids was loaded from the active world storage instead of generated
+		BlockId ids[CHUNK_VOLUME];
+	};
+
+	static TerrainGenerator* generator;		// fills new chunks
+	static int loadRadius;		// see STREAM_LOAD_RADIUS
+	static int unloadRadius;	// see STREAM_UNLOAD_MARGIN
+	static bool hasCenter;		// whether or not center is set yet
+	static glm::ivec2 center;		// position (x, z) of the chunk the camera was in during the last update
+	static glm::vec3 cameraPos;		// camera position during the last update
+	static glm::vec3 cameraForward;		// camera direction during the last update
+	static glm::vec3 sortedPos;		// camera position when the queues were last sorted
+	static glm::vec3 sortedForward;		// camera direction when the queues were last sorted
+
+	static std::deque<glm::ivec2> waiting;		// chunks to give to the workers, highest priority first
+	static std::map<ChunkKey, GeneratedChunk*> generating;	// chunks being generated or waiting in ready (so they aren't queued twice)
+	static std::deque<GeneratedChunk*> ready;	// generated chunks waiting to be added to the world, highest priority first (render thread only)
+	static std::deque<glm::ivec2> meshWaiting;		// loaded chunks to give to the workers for meshing, highest priority first
+	static std::set<ChunkKey> meshQueued;		// keys of the chunks in meshWaiting
+	static std::atomic<int> meshing;	// number of streamer meshing jobs which haven't finished
+
+	static std::mutex finishedMutex;	// protects finished
+	static std::vector<GeneratedChunk*> finished;		// chunks finished (or skipped) by workers since the last update
+
+	static bool isInRadius(int chunkX, int chunkZ, int radius);		// whether or not the chunk at (chunkX, chunkZ) is within radius chunks of center
+	static void queueMissingChunks();		// refills waiting with the chunks in the load radius which aren't loaded or generating
+	static void cancelFarChunks();		// cancels the generation of chunks which left the load radius, and resumes those which came back
+	static void unloadFarChunks(StreamStats& stats);	// removes the chunks outside the unload radius (queueing the edited ones for saving) and remeshes their loaded neighbors
+	static bool loadChunk(GeneratedChunk* generated);		// adds a generated chunk to the world and queues it and its neighbors for meshing, false if the chunk already exists
+	static void queueMesh(int chunkX, int chunkZ);		// queues the chunk at (chunkX, chunkZ) for meshing
+	static void queueNeighborMeshes(int chunkX, int chunkZ);	// queues the loaded neighbors of the chunk at (chunkX, chunkZ) whose edges changed for meshing
+	static void sortQueues();	// sorts the waiting, ready and meshWaiting queues by priority
+public:
+	static void init(TerrainGenerator* terrain);	// sets the generator used for new chunks, it must stay alive until the job system has finished
+	static void setLoadRadius(int radius);		// sets the load radius (in chunks), the unload radius follows it
+
+	static StreamStats update(Camera* camera);		// loads and unloads chunks around the camera (render thread, once per frame)
+	static void clear();		// drops the queued and generated chunks which haven't been added yet (once no more jobs are running)
+
+	static float getPriority(int chunkX, int chunkZ);		// returns the priority of the chunk at (chunkX, chunkZ) as of the last update, lower goes first
+	static int getLoadRadius();		// returns the load radius (in chunks)
+	static int getUnloadRadius();	// returns the unload radius (in chunks)
+};
@@ -1,6 +1,8 @@
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <algorithm>
+#include <atomic>
 
 #include <GL/glew.h>
 #include <glm/gtc/type_ptr.hpp>
@@ -8,6 +10,12 @@
 #include "drawing.h"
 #include "texture.h"
 #include "chunk.h"
+#include "chunk_render.h"
+#include "mesh_pool.h"
+#include "staging_ring.h"
+#include "epoch.h"
+#include "chunk_streamer.h"
+#include "profiler.h"
 
 Shader::Shader() : progInit(false) {
 	progId = glCreateProgram();
@@ -80,13 +88,75 @@ void Shader::linkProgram() {
 	progInit = true;
 }
 
-std::ostream& operator<<(std::ostream& out, Vertex& vert) {
-	out << "Vertex: [position: (" << vert.pos[0] << ", " << vert.pos[1] << ", " << vert.pos[2] << "), "
-		<< "texture coords: (" << vert.texturePos[0] << ", " << vert.texturePos[1] << ")]";
-	return out;
+void setChunkVertexAttributes() {
+#if PACKED_VERTICES
+	// both words go to one integer attribute, the shader unpacks them
+	glVertexAttribIPointer(0, 2, GL_UNSIGNED_INT, sizeof(PackedVertex), (void*) 0);
+	glEnableVertexAttribArray(0);
+#else
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*) 0);
+	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*) (3 * sizeof(float)));
+	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*) (5 * sizeof(float)));
+	glEnableVertexAttribArray(0);
+	glEnableVertexAttribArray(1);
+	glEnableVertexAttribArray(2);
+#endif
 }
 
-void drawChunks(unsigned int shaderId, glm::mat4& camMatrix) {
+unsigned int getQuadIndexBuffer() {
+	static unsigned int bufferId = 0;
+
+	// only generate the buffer once
+	if (bufferId != 0) {
+		return bufferId;
+	}
+
+	// every quad uses the same pattern, offset by 4 vertices per quad
+	std::vector<unsigned short> indices = std::vector<unsigned short>(MAX_CHUNK_QUADS * 6);
+	for (int quad = 0; quad < MAX_CHUNK_QUADS; quad++) {
+		unsigned short first = quad * 4;
+		indices[quad * 6] = first;
+		indices[quad * 6 + 1] = first + 1;
+		indices[quad * 6 + 2] = first + 2;
+		indices[quad * 6 + 3] = first;
+		indices[quad * 6 + 4] = first + 2;
+		indices[quad * 6 + 5] = first + 3;
+	}
+
+	glCreateBuffers(1, &bufferId);
+	glNamedBufferData(bufferId, indices.size() * sizeof(unsigned short), &indices[0], GL_STATIC_DRAW);
+
+	return bufferId;
+}
+
+// current render path, changed with setRenderPath (atomic since the game thread toggles it while the main thread draws)
+static std::atomic<int> renderPath(RENDER_MULTI_DRAW);
+
+void setRenderPath(int path) {
+	renderPath = path;
+}
+
+int getRenderPath() {
+	return renderPath;
+}
+
+DrawStats drawChunks(unsigned int shaderId, glm::mat4& camMatrix) {
+	PROFILE_ZONE("drawChunks");
+
+	DrawStats stats;
+
+	// per-frame draw lists (one command list per mesh pool arena), kept between frames to reuse their memory
+	static std::vector<DrawCommand> arenaCommands[MESH_MAX_ARENAS];
+	static std::vector<DrawCommand> commands;
+	static std::vector<glm::vec4> positions;
+	static unsigned int commandBufferId = 0;
+	static size_t commandCapacity = 0;
+	for (std::vector<DrawCommand>& list : arenaCommands) {
+		list.clear();
+	}
+	commands.clear();
+	positions.clear();
+
 	// activate the shader
 	glUseProgram(shaderId);
 
@@ -94,30 +164,150 @@ void drawChunks(unsigned int shaderId, glm::mat4& camMatrix) {
 	unsigned int camLoc = glGetUniformLocation(shaderId, "camera");
 	glUniformMatrix4fv(camLoc, 1, GL_FALSE, glm::value_ptr(camMatrix));
 
-	// find model location
-	unsigned int modelLoc = glGetUniformLocation(shaderId, "model");
+	// planes of the camera's view, used to skip chunks which are off-screen
+	Frustum frustum = Frustum(camMatrix);
 
 	// bind block sheet
 	Block::bindSpritesheet(shaderId);
 
-	// get the chunk list and loop through it
-	for (auto entry = Chunk::chunkList.begin(); entry != Chunk::chunkList.end(); entry++) {
-		Chunk* chunk = entry->second;	// current chunk
+	// free the staging space of uploads the gpu has finished, and take the meshes the workers finished since the last frame
+	StagingRing::beginFrame();
+	ChunkRenderState::receiveMeshes();
+
+	// get the chunk list and find the visible chunks, chunks removed meanwhile stay alive until the guard ends
+	EpochGuard guard;
+	static std::vector<Chunk*> chunks;
+	static std::vector<Chunk*> visibleChunks;
+	static std::vector<std::pair<float, ChunkRenderState*>> uploads;
+	chunks.clear();
+	visibleChunks.clear();
+	uploads.clear();
+	Chunk::chunkList.getAll(chunks);
+	for (Chunk* chunk : chunks) {
+		glm::vec3 chunkPos = chunk->getPosition();
+
+		// skip if the chunk has no mesh yet, but count it if it's in view
+		ChunkRenderState* render = chunk->getRenderState();
+		if (render == nullptr) {
+			if (frustum.intersectsBox(chunkPos, chunkPos + glm::vec3(CHUNK_SIZE, WORLD_HEIGHT, CHUNK_SIZE))) {
+				stats.chunksPending++;
+			}
+			continue;
+		}
+
+		// a pending mesh which keeps missing its upload gives up its staging region
+		render->waitFrame();
+
+		if (render->getVertexCount() == 0 && render->isUploaded()) {
+			continue;
+		}
+
+		// skip chunks outside of the view, using the height range which actually has faces
+		stats.chunksTested++;
+		glm::vec3 boxMin = glm::vec3(chunkPos.x, render->getMinHeight(), chunkPos.z);
+		glm::vec3 boxMax = glm::vec3(chunkPos.x + CHUNK_SIZE, render->getMaxHeight(), chunkPos.z + CHUNK_SIZE);
+		if (!frustum.intersectsBox(boxMin, boxMax)) {
+			stats.chunksCulled++;
+			continue;
+		}
 
-		// skip if the chunk isn't updated
-		if (!chunk->isDataUpdated()) {
+		visibleChunks.push_back(chunk);
+		if (!render->isUploaded()) {
+			uploads.push_back(std::make_pair(ChunkStreamer::getPriority(chunkPos.x, chunkPos.z), render));
+		}
+	}
+
+	// upload the most important meshes first while the budget allows it, a chunk which has to wait keeps drawing its old mesh
+	std::sort(uploads.begin(), uploads.end(), [](const std::pair<float, ChunkRenderState*>& a, const std::pair<float, ChunkRenderState*>& b) {
+		return a.first < b.first;
+	});
+	for (std::pair<float, ChunkRenderState*>& upload : uploads) {
+		size_t uploadSize = upload.second->getUploadSize();
+		if (stats.uploads == 0 || stats.uploadBytes + uploadSize <= UPLOAD_BUDGET_BYTES) {
+			upload.second->upload();
+			stats.uploads++;
+			stats.uploadBytes += uploadSize;
+		}
+		else {
+			stats.uploadsDeferred++;
+		}
+	}
+
+	// build a draw for every visible chunk
+	for (Chunk* chunk : visibleChunks) {
+		ChunkRenderState* render = chunk->getRenderState();
+
+		// skip the chunk if it has nothing in the pool
+		if (render->getVertexCount() == 0) {
 			continue;
 		}
 
-		// update buffer
-		chunk->updateBuffer();
+		// position replaces the model matrix, the draw's base instance selects it
+		GpuAllocation mesh = render->getMesh();
+		DrawCommand command;
+		command.count = render->getIndexCount();
+		command.instanceCount = 1;
+		command.firstIndex = 0;
+		command.baseVertex = MeshPool::getBaseVertex(mesh);
+		command.baseInstance = positions.size();
+		arenaCommands[mesh.arena].push_back(command);
+		positions.push_back(glm::vec4(chunk->getPosition(), 0));
 
-		// send model
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(chunk->getModelMatrix()));
+		// update stats
+		stats.vertices += render->getVertexCount();
+		stats.indices += render->getIndexCount();
+	}
 
-		// bind vao and draw
-		glBindVertexArray(chunk->getVaoId());
+	// the copies out of the staging ring are done once the gpu reaches this point
+	StagingRing::endFrame();
 
-		glDrawArrays(GL_TRIANGLES, 0, chunk->getVertexCount());
+	if (positions.empty()) {
+		return stats;
 	}
+
+	// upload positions
+	MeshPool::setDrawPositions(positions);
+
+	if (renderPath == RENDER_MULTI_DRAW) {
+		// put the arenas' commands after each other, so they can be uploaded at once
+		for (std::vector<DrawCommand>& list : arenaCommands) {
+			commands.insert(commands.end(), list.begin(), list.end());
+		}
+
+		// upload the commands, growing the buffer if needed
+		if (commandBufferId == 0) {
+			glGenBuffers(1, &commandBufferId);
+		}
+		if (commands.size() > commandCapacity) {
+			commandCapacity = commands.size() * 2;
+			glNamedBufferData(commandBufferId, commandCapacity * sizeof(DrawCommand), nullptr, GL_STREAM_DRAW);
+		}
+		glNamedBufferSubData(commandBufferId, 0, commands.size() * sizeof(DrawCommand), &commands[0]);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBufferId);
+
+		// draw all chunks of each arena at once
+		size_t firstCommand = 0;
+		for (int arena = 0; arena < MeshPool::getArenaCount(); arena++) {
+			if (arenaCommands[arena].empty()) {
+				continue;
+			}
+
+			glBindVertexArray(MeshPool::getVaoId(arena));
+			glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_SHORT, (void*) (firstCommand * sizeof(DrawCommand)), arenaCommands[arena].size(), 0);
+			firstCommand += arenaCommands[arena].size();
+			stats.drawCalls++;
+		}
+	}
+	else {
+		// one draw per chunk
+		for (int arena = 0; arena < MeshPool::getArenaCount(); arena++) {
+			glBindVertexArray(MeshPool::getVaoId(arena));
+			for (DrawCommand& command : arenaCommands[arena]) {
+				glDrawElementsInstancedBaseVertexBaseInstance(GL_TRIANGLES, command.count, GL_UNSIGNED_SHORT, (void*) 0, 1, command.baseVertex, command.baseInstance);
+				stats.drawCalls++;
+			}
+		}
+	}
+
+	return stats;
 }
\ No newline at end of file
@@ -3,12 +3,20 @@
 #include <string>
 #include <vector>
 #include <iostream>
+#include <cstdint>
 
 #include <GL/glew.h>
 #include <glm/glm.hpp>
 
 #include "block.h"
 #include "camera.h"
+#include "vertex.h"
+
+// ways of submitting chunk draws (see setRenderPath)
+#define RENDER_PER_CHUNK 0		// one draw call per visible chunk
+#define RENDER_MULTI_DRAW 1		// all visible chunks in a single glMultiDrawElementsIndirect call
+
+#define UPLOAD_BUDGET_BYTES (2 * 1024 * 1024)	// most mesh bytes uploaded per frame, the rest waits for later frames (at least one chunk always uploads)
 
 // class for shader program
 class Shader {
@@ -22,12 +30,33 @@ public:
 	void linkProgram();		// links the program after all shaders have been added and checks for errors
 };
 
-// standard vertex for use with VBOs
-struct Vertex{
-	float pos[3];		// position of vertex
-	float texturePos[2];	// texture coordinates
+// layout of one indirect draw, as read by glMultiDrawElementsIndirect
+struct DrawCommand {
+	unsigned int count;		// number of indices
+	unsigned int instanceCount;		// always 1
+	unsigned int firstIndex;	// always 0, every chunk uses the start of the quad index buffer
+	int baseVertex;		// index of the chunk's first vertex in its mesh pool arena
+	unsigned int baseInstance;		// index of the chunk's position in the draw position buffer
+};
 
-	friend std::ostream& operator<<(std::ostream& out, Vertex& vert);
+// counters for one call of drawChunks
+struct DrawStats {
+	int chunksTested;	// number of chunks with a mesh tested against the view frustum
+	int chunksCulled;	// number of chunks skipped because they are outside the view frustum
+	int drawCalls;		// number of draw calls issued
+	size_t vertices;	// number of vertices in the drawn meshes (4 per quad)
+	size_t indices;		// number of indices drawn (6 per quad), i.e. the vertices needed without an index buffer
+	int uploads;	// number of chunk meshes uploaded
+	size_t uploadBytes;		// number of mesh bytes uploaded
+	int uploadsDeferred;	// number of chunk meshes left for a later frame because the upload budget ran out
+	int chunksPending;		// number of chunks in view whose first mesh hasn't reached the render thread yet
+
+	DrawStats() : chunksTested(0), chunksCulled(0), drawCalls(0), vertices(0), indices(0), uploads(0), uploadBytes(0), uploadsDeferred(0), chunksPending(0) {}
 };
 
-void drawChunks(unsigned int shaderId, glm::mat4& camMatrix);	// draw all the chunks in the chunk list
\ No newline at end of file
+void setChunkVertexAttributes();	// sets up the vertex attributes of ChunkVertex for the currently bound vao and buffer
+unsigned int getQuadIndexBuffer();		// returns the index buffer shared by all chunk meshes (2 triangles per 4 vertices), created on first use
+
+void setRenderPath(int path);	// select how chunks are submitted (RENDER_*), safe to call from any thread
+int getRenderPath();	// returns the current render path
+DrawStats drawChunks(unsigned int shaderId, glm::mat4& camMatrix);	// draw all the chunks in the chunk list, uploading pending meshes in ChunkStreamer priority order
\ No newline at end of file
@@ -0,0 +1,105 @@
+#include <iostream>
+#include <cstdlib>
+
+#include "epoch.h"
+
+std::atomic<uint64_t> Epoch::globalEpoch(1);
+Epoch::ThreadSlot Epoch::slots[EPOCH_MAX_THREADS];
+std::mutex Epoch::retiredMutex;
+std::vector<Epoch::Retired> Epoch::retired = std::vector<Epoch::Retired>();
+
+// owns a slot for the lifetime of a thread, so threads which exit give theirs back
+struct SlotOwner {
+	int index;		// index of the slot (-1 if none claimed yet)
+	int depth;		// number of nested guards on this thread
+
+	SlotOwner() : index(-1), depth(0) {}
+	~SlotOwner();
+};
+
+static thread_local SlotOwner slotOwner;
+
+Epoch::ThreadSlot& Epoch::getThreadSlot() {
+	if (slotOwner.index < 0) {
+		for (int i = 0; i < EPOCH_MAX_THREADS; i++) {
+			bool expected = false;
+			if (slots[i].used.compare_exchange_strong(expected, true)) {
+				slotOwner.index = i;
+				break;
+			}
+		}
+
+		// a reader without a slot would make reclamation unsafe, so this can't be recovered from
+		if (slotOwner.index < 0) {
+			std::cerr << "More than " << EPOCH_MAX_THREADS << " threads are using epoch guards." << std::endl;
+			std::abort();
+		}
+	}
+
+	return slots[slotOwner.index];
+}
+
+SlotOwner::~SlotOwner() {
+	if (index >= 0) {
+		Epoch::slots[index].epoch = 0;
+		Epoch::slots[index].used = false;
+	}
+}
+
+void Epoch::retire(std::function<void()> deleter) {
+	std::lock_guard<std::mutex> lock(retiredMutex);
+	retired.push_back({ globalEpoch.load(), std::move(deleter) });
+}
+
+void Epoch::collect() {
+	// readers entering from now on can't see anything retired before the new epoch, but objects retired at the new epoch (while this
+	// runs) can still be seen by readers entering after the scan, so they have to wait for the next collect
+	uint64_t newEpoch = ++globalEpoch;
+
+	// oldest epoch any active reader entered at, capped at the new epoch
+	uint64_t oldest = newEpoch;
+	for (ThreadSlot& slot : slots) {
+		uint64_t epoch = slot.epoch.load();
+		if (epoch != 0 && epoch < oldest) {
+			oldest = epoch;
+		}
+	}
+
+	// objects retired before the oldest reader entered are unreachable, run their deleters outside the lock
+	std::vector<Retired> ready;
+	{
+		std::lock_guard<std::mutex> lock(retiredMutex);
+		for (size_t i = 0; i < retired.size();) {
+			if (retired[i].epoch < oldest) {
+				ready.push_back(std::move(retired[i]));
+				retired[i] = std::move(retired.back());
+				retired.pop_back();
+			}
+			else {
+				i++;
+			}
+		}
+	}
+
+	for (Retired& entry : ready) {
+		entry.deleter();
+	}
+}
+
+size_t Epoch::getRetiredCount() {
+	std::lock_guard<std::mutex> lock(retiredMutex);
+	return retired.size();
+}
+
+EpochGuard::EpochGuard() {
+	// only the outermost guard publishes an epoch
+	if (slotOwner.depth++ == 0) {
+		Epoch::getThreadSlot().epoch = Epoch::globalEpoch.load();
+	}
+}
+
+EpochGuard::~EpochGuard() {
+	if (--slotOwner.depth == 0) {
+		Epoch::slots[slotOwner.index].epoch = 0;
+	}
+}
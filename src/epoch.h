@@ -0,0 +1,51 @@
+#pragma once
+
+#include <vector>
+#include <functional>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+
+#define EPOCH_MAX_THREADS 128	// most threads which can be inside an EpochGuard at the same time
+
+// epoch-based reclamation for data which is read without locks
+// readers hold an EpochGuard while they use shared pointers, writers unlink an object first and then retire it
+// a retired object is deleted by collect once no guard which could still see it is active
+class Epoch {
+private:
+	// one slot per thread, padded so threads don't share cache lines
+	struct alignas(64) ThreadSlot {
+		std::atomic<bool> used;		// whether or not a thread owns this slot
+		std::atomic<uint64_t> epoch;	// epoch the thread entered its guard at (0 = not inside a guard)
+	};
+
+	// a retired object and the epoch it was retired at
+	struct Retired {
+		uint64_t epoch;
+		std::function<void()> deleter;
+	};
+
+	static std::atomic<uint64_t> globalEpoch;	// current epoch, advanced by collect
+	static ThreadSlot slots[EPOCH_MAX_THREADS];
+	static std::mutex retiredMutex;		// protects retired
+	static std::vector<Retired> retired;	// objects waiting to be deleted
+
+	static ThreadSlot& getThreadSlot();		// returns the slot of the calling thread, claiming one on first use
+
+	friend class EpochGuard;
+	friend struct SlotOwner;
+public:
+	static void retire(std::function<void()> deleter);		// deletes an object (by calling deleter) once no current reader can still see it, the object must already be unlinked
+	static void collect();		// advances the epoch and runs the deleters which are safe to run now
+	static size_t getRetiredCount();	// returns the number of objects waiting to be deleted
+};
+
+// marks the calling thread as a reader until it goes out of scope, guards can be nested
+class EpochGuard {
+public:
+	EpochGuard();
+	~EpochGuard();
+
+	EpochGuard(const EpochGuard&) = delete;
+	EpochGuard& operator=(const EpochGuard&) = delete;
+};
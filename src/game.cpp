@@ -1,74 +1,316 @@
 #include <iostream>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
 #include <GL/glew.h>
 #include <GLFW\glfw3.h>
 
 #include "game.h"
 #include "camera.h"
+#include "chunk.h"
+#include "drawing.h"
+#include "input_queue.h"
+#include "profiler.h"
 
 #define MOUSE_SENS 0.08		// mouse sensitivity
 #define MOVE_SPEED 5		// speed on key presses (units per second)
+#define MAX_CATCH_UP_TICKS 5	// most ticks run back to back after a stall, anything further behind is dropped so the game doesn't spiral
+#define MIN_SLEEP_MARGIN 0.001		// the game thread wakes up at least this many seconds before a tick is due and yields until then
+#define MAX_SLEEP_MARGIN 0.004		// and at most this many, a longer overshoot (the whole machine being busy) is taken as lateness instead of spun away
+
+static InputQueue inputQueue;	// input captured by the glfw callbacks (main thread) for the game thread
+static bool keysDown[GLFW_KEY_LAST + 1];	// which keys are held, as of the input the game thread has applied (game thread only)
+static CameraBuffer cameraBuffer((CameraState()));		// the active camera as of the last tick, for the render thread
+static std::atomic<bool> meshReportRequested(false);		// set when the meshing mode is switched, see takeMeshReportRequest
+static uint64_t drawnTick = 0;		// tick of the camera state getRenderCamera last returned (render thread only)
+
+static std::mutex statsMutex;		// protects the stats below
+static TickStats stats;		// timing since the last getTickStats, the averages hold totals until then
+static double statsCpuTime = 0;		// cpu time (seconds) used by the game thread since the last getTickStats
+static double statsStartTime = 0;		// when getTickStats was last called
+static int frameInputCount = 0;		// number of camera states with input picked up by the render thread since the last getTickStats (render thread only)
+static double frameInputTotalMs = 0;	// total input to frame latency of those states (render thread only)
+static double frameInputMaxMs = 0;		// longest input to frame latency of those states (render thread only)
 
+// cpu time (seconds) used by the calling thread so far
+static double getThreadCpuTime() {
+#ifdef _WIN32
+	FILETIME creation, exit, kernel, user;
+	if (!GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user)) {
+		return 0;
+	}
+
+	// both times are in 100 ns units
+	ULARGE_INTEGER kernelTime, userTime;
+	kernelTime.LowPart = kernel.dwLowDateTime;
+	kernelTime.HighPart = kernel.dwHighDateTime;
+	userTime.LowPart = user.dwLowDateTime;
+	userTime.HighPart = user.dwHighDateTime;
+	return (kernelTime.QuadPart + userTime.QuadPart) * 1e-7;
+#else
+	timespec time;
+	if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time) != 0) {
+		return 0;
+	}
+	return time.tv_sec + time.tv_nsec * 1e-9;
+#endif
+}
+
+// glfw only allows input on the main thread, so the callbacks just queue the events for the game thread
 static void mouseCallback(GLFWwindow* window, double x, double y) {
 	// need to keep track of previous x and y to calculate deltas
 	static double lastX = x;
 	static double lastY = y;
 
-	// calculate deltas
-	double deltaX = x - lastX;
-	double deltaY = y - lastY;
-
-	// rotate camera
-	Camera::getActiveCam()->rotateYaw(-deltaX * MOUSE_SENS);
-	Camera::getActiveCam()->rotatePitch(-deltaY * MOUSE_SENS);
+	// queue deltas
+	InputEvent event;
+	event.type = INPUT_MOUSE_MOVE;
+	event.key = GLFW_KEY_UNKNOWN;
+	event.deltaX = (float) (x - lastX);
+	event.deltaY = (float) (y - lastY);
+	event.time = glfwGetTime();
+	inputQueue.push(event);
 
 	// update "last" vars
 	lastX = x;
 	lastY = y;
 }
 
-// deals with key presses
+static void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods) {
+	// repeats don't change which keys are held
+	if (key == GLFW_KEY_UNKNOWN || action == GLFW_REPEAT) {
+		return;
+	}
+
+	InputEvent event;
+	event.type = (action == GLFW_PRESS) ? INPUT_KEY_DOWN : INPUT_KEY_UP;
+	event.key = key;
+	event.deltaX = 0;
+	event.deltaY = 0;
+	event.time = glfwGetTime();
+	inputQueue.push(event);
+}
+
+// deals with single key presses (once per press)
+static void processKeyPress(int key) {
+	// toggle between naive and greedy meshing, the workers remesh every chunk without holding up the tick (main prints the report once they're done)
+	if (key == GLFW_KEY_G) {
+		Chunk::setMeshingMode(Chunk::getMeshingMode() == MESHING_GREEDY ? MESHING_NAIVE : MESHING_GREEDY);
+		Chunk::submitAllChunks();
+		meshReportRequested = true;
+	}
+
+	// toggle between one draw per chunk and a single multi-draw
+	if (key == GLFW_KEY_M) {
+		setRenderPath(getRenderPath() == RENDER_MULTI_DRAW ? RENDER_PER_CHUNK : RENDER_MULTI_DRAW);
+	}
+
+	// write the zones recorded by the profiler
+	if (key == GLFW_KEY_P) {
+		Profiler::writeTrace(PROFILER_TRACE_PATH);
+	}
+}
+
+// applies the queued input to the active camera, returns when the newest event was captured (0 if there were none)
+// inputStats gets the number of events and how long they waited (the total in averageInputToTickMs)
+static double processInput(double tickStartTime, TickStats& inputStats) {
+	double newestTime = 0;
+	InputEvent event;
+	while (inputQueue.pop(event)) {
+		newestTime = event.time;
+		inputStats.inputEvents++;
+		inputStats.averageInputToTickMs += (tickStartTime - event.time) * 1000;
+		inputStats.maxInputToTickMs = std::max(inputStats.maxInputToTickMs, (tickStartTime - event.time) * 1000);
+
+		// rotate camera
+		if (event.type == INPUT_MOUSE_MOVE) {
+			Camera::getActiveCam()->rotateYaw(-event.deltaX * MOUSE_SENS);
+			Camera::getActiveCam()->rotatePitch(-event.deltaY * MOUSE_SENS);
+			continue;
+		}
+
+		keysDown[event.key] = (event.type == INPUT_KEY_DOWN);
+		if (event.type == INPUT_KEY_DOWN) {
+			processKeyPress(event.key);
+		}
+	}
+
+	return newestTime;
+}
+
+// deals with held keys
 // delta is used to make sure movement speed doesn't change based on computer performance
-static void processKeys(GLFWwindow* window, float delta) {
+static void processKeys(float delta) {
 	float camSpeed = MOVE_SPEED * delta;
 
 	// process key presses
-	if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS) {
+	if (keysDown[GLFW_KEY_W]) {
 		Camera::getActiveCam()->translate(Camera::getActiveCam()->getForward() * camSpeed);
 	}
-	if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS) {
+	if (keysDown[GLFW_KEY_S]) {
 		Camera::getActiveCam()->translate(Camera::getActiveCam()->getForward() * -camSpeed);
 	}
-	if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS) {
+	if (keysDown[GLFW_KEY_A]) {
 		Camera::getActiveCam()->translate(Camera::getActiveCam()->getRight() * -camSpeed);
 	}
-	if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS) {
+	if (keysDown[GLFW_KEY_D]) {
 		Camera::getActiveCam()->translate(Camera::getActiveCam()->getRight() * camSpeed);
 	}
-	if (glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS) {
+	if (keysDown[GLFW_KEY_SPACE]) {
 		Camera::getActiveCam()->translate(Camera::getActiveCam()->getUp() * camSpeed);
 	}
-	if (glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS) {
+	if (keysDown[GLFW_KEY_LEFT_SHIFT]) {
 		Camera::getActiveCam()->translate(Camera::getActiveCam()->getUp() * -camSpeed);
 	}
 }
 
+// waits until the given time (from glfwGetTime)
+// sleeping can overshoot by a whole scheduler slice, so the thread sleeps until sleepMargin seconds before the deadline and yields for the
+// rest, and the margin grows to the largest recent overshoot (then shrinks back) so the wake up stays on time
+static void waitUntil(double time, double& sleepMargin) {
+	double sleepTime = time - glfwGetTime() - sleepMargin;
+	if (sleepTime > 0) {
+		double sleepStartTime = glfwGetTime();
+		std::this_thread::sleep_for(std::chrono::duration<double>(sleepTime));
+		double overshoot = glfwGetTime() - sleepStartTime - sleepTime;
+		sleepMargin = std::min(std::max(std::max(overshoot, sleepMargin * 0.95), MIN_SLEEP_MARGIN), MAX_SLEEP_MARGIN);
+	}
+
+	while (glfwGetTime() < time) {
+		std::this_thread::yield();
+	}
+}
+
 static void startGameHelper(GLFWwindow* window) {
-	// mouse input setup
-	glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
-	glfwSetCursorPosCallback(window, mouseCallback);	// add mouse callback
+	PROFILE_THREAD("game");
+
+	const double tickLength = 1.0 / TICK_RATE;
+	double nextTickTime = glfwGetTime();	// when the next tick is due
+	double sleepMargin = MIN_SLEEP_MARGIN;		// see waitUntil
+	double cpuTime = getThreadCpuTime();	// cpu time used so far, to add the difference to the stats
+	uint64_t tick = 0;		// number of the last tick
 
-	float delta = glfwGetTime();		// used to keep track of time between loop iterations
 	// keep running until window should close (same as rendering loop)
 	while (!glfwWindowShouldClose(window)) {
-		float loopStartTime = glfwGetTime();	// used to update delta
-		processKeys(window, delta);
-	
+		// run every tick which is due, each one moves the game forward by exactly tickLength no matter how late it runs
+		double behind = glfwGetTime() - nextTickTime;
+		int dueTicks = (behind < 0) ? 0 : (int) (behind / tickLength) + 1;
+		int droppedTicks = std::max(dueTicks - MAX_CATCH_UP_TICKS, 0);
+		nextTickTime += droppedTicks * tickLength;
+
+		for (int i = droppedTicks; i < dueTicks; i++) {
+			PROFILE_ZONE("tick");
+			double tickStartTime = glfwGetTime();
+			TickStats inputStats;	// input applied by this tick
+
+			CameraState state;
+			state.previous = *Camera::getActiveCam();
+			state.inputTime = processInput(tickStartTime, inputStats);
+			processKeys(tickLength);
+			state.current = *Camera::getActiveCam();
+			state.tick = ++tick;
+			state.tickTime = nextTickTime;
+			cameraBuffer.publish(state);
+			nextTickTime += tickLength;
 
+			double tickEndTime = glfwGetTime();
+			std::lock_guard<std::mutex> lock(statsMutex);
+			stats.ticks++;
+			stats.averageTickMs += (tickEndTime - tickStartTime) * 1000;
+			stats.maxTickMs = std::max(stats.maxTickMs, (tickEndTime - tickStartTime) * 1000);
+			stats.maxLateMs = std::max(stats.maxLateMs, (tickStartTime - state.tickTime) * 1000);
+			stats.inputEvents += inputStats.inputEvents;
+			stats.averageInputToTickMs += inputStats.averageInputToTickMs;
+			stats.maxInputToTickMs = std::max(stats.maxInputToTickMs, inputStats.maxInputToTickMs);
+		}
 
-		delta = glfwGetTime() - loopStartTime;
+		double newCpuTime = getThreadCpuTime();
+		{
+			std::lock_guard<std::mutex> lock(statsMutex);
+			stats.droppedTicks += droppedTicks;
+			statsCpuTime += newCpuTime - cpuTime;
+		}
+		cpuTime = newCpuTime;
+
+		// sleep instead of spinning until the next tick
+		waitUntil(nextTickTime, sleepMargin);
 	}
 }
 
 std::thread* startGame(GLFWwindow* window) {
+	// input setup, the callbacks run on this (the main) thread when it polls events
+	glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+	glfwSetCursorPosCallback(window, mouseCallback);	// add mouse callback
+	glfwSetKeyCallback(window, keyCallback);
+
+	// the render thread draws the camera where it starts until the first tick
+	CameraState state;
+	state.previous = *Camera::getActiveCam();
+	state.current = *Camera::getActiveCam();
+	state.tickTime = glfwGetTime();
+	cameraBuffer.publish(state);
+
 	return new std::thread(startGameHelper, window);
+}
+
+Camera getRenderCamera() {
+	CameraState& state = cameraBuffer.read();
+	double now = glfwGetTime();
+
+	// input to frame latency, counted once per tick
+	if (state.tick != drawnTick && state.inputTime > 0) {
+		frameInputCount++;
+		frameInputTotalMs += (now - state.inputTime) * 1000;
+		frameInputMaxMs = std::max(frameInputMaxMs, (now - state.inputTime) * 1000);
+	}
+	drawnTick = state.tick;
+
+	// the camera moves from where it was a tick before to where it is over the tick after (so it is drawn up to one tick behind)
+	float alpha = (float) ((now - state.tickTime) * TICK_RATE);
+	return state.previous.interpolate(state.current, std::min(std::max(alpha, 0.0f), 1.0f));
+}
+
+bool takeMeshReportRequest() {
+	return meshReportRequested.exchange(false);
+}
+
+TickStats getTickStats() {
+	std::lock_guard<std::mutex> lock(statsMutex);
+	TickStats result = stats;
+	if (result.ticks > 0) {
+		result.averageTickMs /= result.ticks;
+	}
+	if (result.inputEvents > 0) {
+		result.averageInputToTickMs /= result.inputEvents;
+	}
+	result.droppedInputEvents = inputQueue.takeDropped();
+
+	result.maxInputToFrameMs = frameInputMaxMs;
+	if (frameInputCount > 0) {
+		result.averageInputToFrameMs = frameInputTotalMs / frameInputCount;
+	}
+	frameInputCount = 0;
+	frameInputTotalMs = 0;
+	frameInputMaxMs = 0;
+
+	// the first call has no start time, so it covers the whole run so far
+	double now = glfwGetTime();
+	if (now > statsStartTime) {
+		result.cpuUsage = statsCpuTime / (now - statsStartTime);
+	}
+
+	stats = TickStats();
+	statsCpuTime = 0;
+	statsStartTime = now;
+	return result;
 }
\ No newline at end of file
@@ -2,7 +2,34 @@
 
 #include <thread>
 
+#include "camera.h"
+
+#define TICK_RATE 60		// game ticks per second, the simulation always advances by 1 / TICK_RATE seconds per tick
+
+// game thread timing since the last call to getTickStats
+struct TickStats {
+	int ticks;		// number of ticks run
+	int droppedTicks;		// number of ticks skipped because the game thread fell more than MAX_CATCH_UP_TICKS behind
+	double averageTickMs;	// average time spent in a tick
+	double maxTickMs;		// longest tick
+	double maxLateMs;		// latest a tick started after it was due
+	double cpuUsage;	// share of one core used by the game thread (0 to 1)
+	int inputEvents;	// number of input events applied by ticks
+	int droppedInputEvents;		// number of input events lost because the queue was full
+	double averageInputToTickMs;	// average time from capturing an input event to the tick which applied it
+	double maxInputToTickMs;	// longest time from capturing an input event to the tick which applied it
+	double averageInputToFrameMs;	// average time from capturing the newest input of a tick to the render thread picking up the tick's camera
+	double maxInputToFrameMs;	// longest time from capturing the newest input of a tick to the render thread picking up the tick's camera
+
+	TickStats() : ticks(0), droppedTicks(0), averageTickMs(0), maxTickMs(0), maxLateMs(0), cpuUsage(0), inputEvents(0), droppedInputEvents(0),
+		averageInputToTickMs(0), maxInputToTickMs(0), averageInputToFrameMs(0), maxInputToFrameMs(0) {}
+};
+
 // all non-graphics, logic stuff should go in here.
 // contains the game loop.
-// creates and returns a new thread
-std::thread* startGame(GLFWwindow* window);
\ No newline at end of file
+// sets up input on the calling (main) thread, then creates and returns a new thread which owns the active camera
+std::thread* startGame(GLFWwindow* window);
+
+Camera getRenderCamera();	// returns the active camera as of the last tick, moved between that tick and the one before to smooth the movement (render thread)
+TickStats getTickStats();		// returns the game thread timing since the last call (render thread)
+bool takeMeshReportRequest();	// whether or not the meshing mode was switched since the last call, the report is printed by the render thread
@@ -0,0 +1,158 @@
+#include <iostream>
+#include <cstdio>
+#include <algorithm>
+#include <iterator>
+
+#include "gpu_allocator.h"
+
+GpuAllocator::GpuAllocator(unsigned int arenaSize, int maxArenas, unsigned int alignment, GLbitfield storageFlags)
+	: arenaSize(arenaSize / alignment * alignment), maxArenas(maxArenas), alignment(alignment), storageFlags(storageFlags), allocationCount(0), usedBytes(0) {}
+
+GpuAllocator::~GpuAllocator() {
+	if (!arenaBuffers.empty()) {
+		glDeleteBuffers(arenaBuffers.size(), &arenaBuffers[0]);
+	}
+}
+
+bool GpuAllocator::addArena() {
+	if ((int) arenaBuffers.size() >= maxArenas) {
+		return false;
+	}
+
+	// storage is immutable, contents are written with glNamedBufferSubData or copies
+	unsigned int bufferId;
+	glCreateBuffers(1, &bufferId);
+	glNamedBufferStorage(bufferId, arenaSize, nullptr, storageFlags);
+
+	// whole arena starts out free
+	arenaBuffers.push_back(bufferId);
+	freeRanges.push_back(std::map<unsigned int, unsigned int>());
+	freeRanges.back()[0] = arenaSize;
+
+	return true;
+}
+
+bool GpuAllocator::allocateInArena(int arena, unsigned int size, GpuAllocation& allocation) {
+	std::map<unsigned int, unsigned int>& ranges = freeRanges[arena];
+
+	// use the first free range which is big enough
+	for (auto range = ranges.begin(); range != ranges.end(); range++) {
+		if (range->second < size) {
+			continue;
+		}
+
+		allocation.arena = arena;
+		allocation.offset = range->first;
+		allocation.size = size;
+
+		// put any leftover space back
+		unsigned int leftover = range->second - size;
+		ranges.erase(range);
+		if (leftover > 0) {
+			ranges[allocation.offset + size] = leftover;
+		}
+
+		allocationCount++;
+		usedBytes += size;
+		return true;
+	}
+
+	return false;
+}
+
+bool GpuAllocator::allocate(unsigned int bytes, GpuAllocation& allocation) {
+	// round up to the alignment
+	unsigned int size = (bytes + alignment - 1) / alignment * alignment;
+	if (size == 0 || size > arenaSize) {
+		std::cerr << "Invalid gpu allocation size (" << bytes << " bytes)." << std::endl;
+		return false;
+	}
+
+	// try existing arenas first, then new ones
+	for (int arena = 0; arena < (int) arenaBuffers.size(); arena++) {
+		if (allocateInArena(arena, size, allocation)) {
+			return true;
+		}
+	}
+	while (addArena()) {
+		if (allocateInArena(arenaBuffers.size() - 1, size, allocation)) {
+			return true;
+		}
+	}
+
+	std::cerr << "Gpu allocator is full, could not allocate " << bytes << " bytes." << std::endl;
+	return false;
+}
+
+void GpuAllocator::release(GpuAllocation& allocation) {
+	if (allocation.arena < 0) {
+		return;
+	}
+
+	std::map<unsigned int, unsigned int>& ranges = freeRanges[allocation.arena];
+	unsigned int offset = allocation.offset;
+	unsigned int size = allocation.size;
+
+	allocationCount--;
+	usedBytes -= size;
+	allocation = GpuAllocation();
+
+	// add range to free list, merging it with free neighbors
+	auto next = ranges.lower_bound(offset);
+	if (next != ranges.end() && offset + size == next->first) {
+		size += next->second;
+		next = ranges.erase(next);
+	}
+	if (next != ranges.begin()) {
+		auto previous = std::prev(next);
+		if (previous->first + previous->second == offset) {
+			previous->second += size;
+			return;
+		}
+	}
+
+	ranges[offset] = size;
+}
+
+int GpuAllocator::getArenaCount() {
+	return arenaBuffers.size();
+}
+
+unsigned int GpuAllocator::getBuffer(int arena) {
+	return arenaBuffers[arena];
+}
+
+GpuAllocatorStats GpuAllocator::getStats() {
+	GpuAllocatorStats stats;
+	stats.arenas = arenaBuffers.size();
+	stats.capacity = (size_t) arenaSize * arenaBuffers.size();
+	stats.used = usedBytes;
+	stats.allocations = allocationCount;
+	stats.largestFree = 0;
+	stats.freeRanges = 0;
+
+	// sum of each arena's largest free range, for fragmentation
+	size_t largestPerArena = 0;
+	for (std::map<unsigned int, unsigned int>& ranges : freeRanges) {
+		stats.freeRanges += ranges.size();
+
+		size_t largest = 0;
+		for (auto range = ranges.begin(); range != ranges.end(); range++) {
+			largest = std::max(largest, (size_t) range->second);
+		}
+		largestPerArena += largest;
+		stats.largestFree = std::max(stats.largestFree, largest);
+	}
+
+	size_t freeBytes = stats.capacity - stats.used;
+	stats.fragmentation = (freeBytes == 0) ? 0.0f : 1.0f - 1.0f * largestPerArena / freeBytes;
+
+	return stats;
+}
+
+void GpuAllocator::printStats(std::string name) {
+	GpuAllocatorStats stats = getStats();
+	printf("%s: %d arenas, %.1f / %.1f MB used, %d allocations, %d free ranges (largest %.1f MB), fragmentation %.1f%%\n",
+		name.c_str(), stats.arenas, stats.used / 1048576.0, stats.capacity / 1048576.0, stats.allocations,
+		stats.freeRanges, stats.largestFree / 1048576.0, stats.fragmentation * 100);
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <map>
+#include <vector>
+#include <string>
+
+#include <GL/glew.h>
+
+// a range of bytes in one of a GpuAllocator's arenas
+struct GpuAllocation {
+	int arena;		// index of the arena buffer, -1 if nothing is allocated
+	unsigned int offset;	// position of the range in the arena (bytes)
+	unsigned int size;		// size of the range (bytes)
+
+	GpuAllocation() : arena(-1), offset(0), size(0) {}
+};
+
+// usage and fragmentation of a GpuAllocator
+struct GpuAllocatorStats {
+	int arenas;		// number of arenas created
+	size_t capacity;	// total bytes in all arenas
+	size_t used;	// bytes handed out
+	size_t largestFree;		// biggest single free range (bytes)
+	int allocations;	// number of live allocations
+	int freeRanges;		// number of separate free ranges
+	float fragmentation;	// share of free bytes outside of their arena's largest free range, 0 = each arena's free space is in one piece
+};
+
+// sub-allocates a few large immutable buffers (arenas) using a free list per arena
+// arenas are created with glNamedBufferStorage only when the existing ones are full, so the driver never reallocates storage
+// must only be used on the thread with the opengl context
+class GpuAllocator {
+private:
+	std::vector<unsigned int> arenaBuffers;		// buffer id of each arena
+	std::vector<std::map<unsigned int, unsigned int>> freeRanges;	// free ranges of each arena (offset -> size, in bytes)
+	unsigned int arenaSize;		// size of each arena (bytes)
+	int maxArenas;		// arenas are never created past this many
+	unsigned int alignment;		// every offset and size is a multiple of this
+	GLbitfield storageFlags;	// flags given to glNamedBufferStorage
+	int allocationCount;	// number of live allocations
+	size_t usedBytes;	// bytes in live allocations
+
+	bool addArena();	// creates a new arena, returns false if the limit is reached
+	bool allocateInArena(int arena, unsigned int size, GpuAllocation& allocation);	// first-fit allocation in one arena
+public:
+	GpuAllocator(unsigned int arenaSize, int maxArenas, unsigned int alignment, GLbitfield storageFlags = GL_DYNAMIC_STORAGE_BIT);
+	~GpuAllocator();
+
+	bool allocate(unsigned int bytes, GpuAllocation& allocation);	// reserves at least bytes (rounded up to the alignment), returns false if everything is full
+	void release(GpuAllocation& allocation);	// returns the range to its arena (merging it with free neighbors) and resets the allocation
+
+	int getArenaCount();	// returns the number of arenas created so far
+	unsigned int getBuffer(int arena);		// returns the buffer id of an arena
+	GpuAllocatorStats getStats();	// calculates usage and fragmentation
+	void printStats(std::string name);		// prints the stats on one line, prefixed with name
+};
@@ -0,0 +1,33 @@
+#include "input_queue.h"
+
+InputQueue::InputQueue() : head(0), tail(0), dropped(0) {}
+
+bool InputQueue::push(const InputEvent& event) {
+	uint32_t pushed = head.load(std::memory_order_relaxed);
+
+	// the consumer frees slots by advancing tail, acquire so it's done reading them before they are overwritten
+	if (pushed - tail.load(std::memory_order_acquire) == INPUT_QUEUE_SIZE) {
+		dropped.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+
+	// the indices count up forever and wrap around the ring (and uint32_t) together, since the size is a power of 2
+	events[pushed & (INPUT_QUEUE_SIZE - 1)] = event;
+	head.store(pushed + 1, std::memory_order_release);
+	return true;
+}
+
+bool InputQueue::pop(InputEvent& event) {
+	uint32_t popped = tail.load(std::memory_order_relaxed);
+	if (popped == head.load(std::memory_order_acquire)) {
+		return false;
+	}
+
+	event = events[popped & (INPUT_QUEUE_SIZE - 1)];
+	tail.store(popped + 1, std::memory_order_release);
+	return true;
+}
+
+uint32_t InputQueue::takeDropped() {
+	return dropped.exchange(0, std::memory_order_relaxed);
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#define INPUT_QUEUE_SIZE 1024		// most input events waiting for the game thread at once (a power of 2)
+
+enum InputEventType {
+	INPUT_KEY_DOWN,
+	INPUT_KEY_UP,
+	INPUT_MOUSE_MOVE
+};
+
+// a key press or release, or a mouse movement, captured by the glfw callbacks on the main thread
+struct InputEvent {
+	InputEventType type;
+	int key;	// glfw key code (key events only)
+	float deltaX, deltaY;	// cursor movement in pixels (mouse events only)
+	double time;	// when the event was captured (glfwGetTime)
+};
+
+// lock-free ring of input events with a single producer (the main thread, which polls glfw) and a single consumer (the game thread)
+// each side only writes its own index, so neither ever waits for the other, and a push onto a full queue fails instead of blocking
+class InputQueue {
+private:
+	alignas(64) std::atomic<uint32_t> head;		// number of events pushed so far, only written by the producer
+	alignas(64) std::atomic<uint32_t> tail;		// number of events popped so far, only written by the consumer
+	alignas(64) std::atomic<uint32_t> dropped;	// number of events which didn't fit since the last takeDropped
+	InputEvent events[INPUT_QUEUE_SIZE];
+public:
+	InputQueue();
+
+	bool push(const InputEvent& event);		// adds an event, false (and counted as dropped) if the queue is full (producer only)
+	bool pop(InputEvent& event);	// removes the oldest event into event, false if there is none (consumer only)
+	uint32_t takeDropped();		// returns the number of dropped events since the last call and resets it (any thread)
+};
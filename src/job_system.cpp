@@ -0,0 +1,149 @@
+#include <iostream>
+#include <string>
+#include <algorithm>
+
+#include "job_system.h"
+#include "profiler.h"
+
+JobSystem* JobSystem::activeJobSystem = nullptr;
+thread_local JobSystem* JobSystem::currentSystem = nullptr;
+thread_local int JobSystem::currentWorker = -1;
+
+JobSystem* JobSystem::getActive() {
+	return activeJobSystem;
+}
+
+int JobSystem::getDefaultWorkerCount() {
+	int threads = std::thread::hardware_concurrency();
+	return std::max(threads - 1, 1);
+}
+
+JobSystem::JobSystem(int workerCount) : queues(std::max(workerCount, 1)), queuedJobs(0), unfinishedJobs(0), nextQueue(0), jobsRun(0), steals(0), running(true) {
+	for (int i = 0; i < (int) queues.size(); i++) {
+		workers.push_back(std::thread(&JobSystem::workerLoop, this, i));
+	}
+}
+
+JobSystem::~JobSystem() {
+	wait();
+
+	// wake every worker so it can see that it should stop
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		running = false;
+	}
+	sleepCondition.notify_all();
+
+	for (std::thread& worker : workers) {
+		worker.join();
+	}
+
+	if (activeJobSystem == this) {
+		activeJobSystem = nullptr;
+	}
+}
+
+void JobSystem::activate() {
+	activeJobSystem = this;
+}
+
+void JobSystem::submit(Job job) {
+	unfinishedJobs++;
+
+	// workers keep their own jobs local, other threads spread them out
+	int index = (currentSystem == this) ? currentWorker : nextQueue++ % (int) queues.size();
+	{
+		std::lock_guard<std::mutex> lock(queues[index].mutex);
+		queues[index].jobs.push_back(std::move(job));
+	}
+
+	// the sleep mutex is taken so a worker can't miss the job between checking for it and going to sleep
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		queuedJobs++;
+	}
+	sleepCondition.notify_one();
+}
+
+bool JobSystem::takeJob(int index, Job& job) {
+	if (queuedJobs == 0) {
+		return false;
+	}
+
+	// own deque first, newest job (most likely still in cache)
+	{
+		std::lock_guard<std::mutex> lock(queues[index].mutex);
+		if (!queues[index].jobs.empty()) {
+			job = std::move(queues[index].jobs.back());
+			queues[index].jobs.pop_back();
+			queuedJobs--;
+			return true;
+		}
+	}
+
+	// steal the oldest job of another worker, starting with the next one so thieves spread out
+	for (int i = 1; i < (int) queues.size(); i++) {
+		WorkerQueue& victim = queues[(index + i) % queues.size()];
+		std::lock_guard<std::mutex> lock(victim.mutex);
+		if (!victim.jobs.empty()) {
+			job = std::move(victim.jobs.front());
+			victim.jobs.pop_front();
+			queuedJobs--;
+			steals++;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void JobSystem::workerLoop(int index) {
+	currentSystem = this;
+	currentWorker = index;
+	PROFILE_THREAD(("worker " + std::to_string(index)).c_str());
+
+	while (true) {
+		Job job;
+		if (takeJob(index, job)) {
+			job();
+			jobsRun++;
+			unfinishedJobs--;
+			continue;
+		}
+
+		// nothing to do, sleep until a job is submitted or the job system stops
+		std::unique_lock<std::mutex> lock(sleepMutex);
+		sleepCondition.wait(lock, [this] { return !running || queuedJobs > 0; });
+		if (!running && queuedJobs == 0) {
+			return;
+		}
+	}
+}
+
+void JobSystem::wait() {
+	// help out instead of blocking, a worker which waits on its own jobs would otherwise deadlock
+	int index = (currentSystem == this) ? currentWorker : 0;
+	while (unfinishedJobs > 0) {
+		Job job;
+		if (takeJob(index, job)) {
+			job();
+			jobsRun++;
+			unfinishedJobs--;
+		}
+		else {
+			std::this_thread::yield();
+		}
+	}
+}
+
+int JobSystem::getWorkerCount() {
+	return workers.size();
+}
+
+JobStats JobSystem::getStats() {
+	JobStats stats;
+	stats.jobsRun = jobsRun;
+	stats.steals = steals;
+
+	return stats;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+typedef std::function<void()> Job;	// a unit of work run by a job system worker
+
+// counters of a job system since it was created
+struct JobStats {
+	long jobsRun;	// number of jobs finished
+	long steals;	// number of jobs a worker took from another worker's deque
+
+	JobStats() : jobsRun(0), steals(0) {}
+};
+
+// pool of worker threads which run submitted jobs
+// each worker has its own deque: it takes its newest job from the back, and idle workers steal the oldest job from the front of another worker's deque
+// jobs submitted from a worker go to that worker's deque, jobs submitted from other threads are spread round-robin
+class JobSystem {
+private:
+	// per-worker queue of jobs, padded so workers don't share cache lines
+	struct alignas(64) WorkerQueue {
+		std::mutex mutex;
+		std::deque<Job> jobs;
+	};
+
+	static JobSystem* activeJobSystem;		// the job system used by the engine (see activate)
+	static thread_local JobSystem* currentSystem;	// job system of the worker running on this thread (nullptr if not a worker)
+	static thread_local int currentWorker;		// index of the worker running on this thread
+
+	std::vector<std::thread> workers;
+	std::vector<WorkerQueue> queues;	// one per worker
+	std::atomic<int> queuedJobs;	// jobs waiting in a deque
+	std::atomic<int> unfinishedJobs;	// jobs submitted but not finished yet
+	std::atomic<int> nextQueue;		// round-robin position for jobs submitted from outside the workers
+	std::atomic<long> jobsRun, steals;
+	std::mutex sleepMutex;	// idle workers sleep on sleepCondition until a job is submitted
+	std::condition_variable sleepCondition;
+	bool running;
+
+	void workerLoop(int index);		// runs jobs until the job system is destroyed
+	bool takeJob(int index, Job& job);		// takes a job from the given worker's deque, or steals one from another worker, returns false if every deque is empty
+public:
+	static JobSystem* getActive();	// returns the active job system (nullptr if none)
+	static int getDefaultWorkerCount();		// returns one worker per hardware thread, minus one for the render thread
+
+	JobSystem(int workerCount);		// starts workerCount worker threads (at least 1)
+	~JobSystem();	// finishes the queued jobs and stops the workers
+
+	void activate();	// make this the job system used by the engine
+	void submit(Job job);	// queue a job to run on any worker
+	void wait();	// returns once every submitted job has finished, running jobs on the calling thread meanwhile
+
+	int getWorkerCount();	// returns the number of worker threads
+	JobStats getStats();	// returns the counters of this job system
+};
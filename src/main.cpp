@@ -4,6 +4,7 @@
 #include <glm/gtc/type_ptr.hpp>
 #include <stb_image.h>
 #include <thread>
+#include <algorithm>
 
 #include "drawing.h"
 #include "block.h"
@@ -11,14 +12,30 @@
 #include "camera.h"
 #include "game.h"
 #include "chunk.h"
+#include "benchmark.h"
+#include "mesh_pool.h"
+#include "staging_ring.h"
+#include "job_system.h"
+#include "epoch.h"
+#include "terrain.h"
+#include "chunk_streamer.h"
+#include "world_storage.h"
+#include "profiler.h"
 
 #define SHOW_FPS true
 #define FPS_COUNTER_INTERVAL 0.5	// how often (in seconds) to print FPS
+#define RUN_BENCHMARKS false	// run the benchmarks in benchmark.h before the world is created
+#define WORLD_SEED 20240611		// seed of the terrain generator
+#define WORLD_DIRECTORY "world"		// where the world is saved
+#define AUTOSAVE_INTERVAL 30.0		// seconds between saves of the edited chunks (on the save thread)
 
 int main(void)
 {
 	GLFWwindow* window;
 
+	// name the render thread in profiler traces
+	PROFILE_THREAD("main");
+
 	/* Initialize the library */
 	if (!glfwInit())
 		return -1;
@@ -47,35 +64,34 @@ int main(void)
 	// load textures
 	loadTextures();
 
+	// create the allocator which holds all chunk meshes
+	MeshPool::init();
+	StagingRing::init();
+
+	// worker threads which mesh chunks
+	JobSystem jobs(JobSystem::getDefaultWorkerCount());
+	jobs.activate();
+
 	// create shader program
 	Shader shader;
-	shader.addShader("assetts/shaders/shader_vertex.glsl", GL_VERTEX_SHADER);
+	shader.addShader(PACKED_VERTICES ? "assetts/shaders/shader_vertex.glsl" : "assetts/shaders/shader_vertex_float.glsl", GL_VERTEX_SHADER);
 	shader.addShader("assetts/shaders/shader_fragment.glsl", GL_FRAGMENT_SHADER);
 	shader.linkProgram();
-	
-	// test blocks
-	for (int y = 0; y < 5; y++) {
-		std::string blockName;
-		if (y == 0 || y == 1) {
-			blockName = "stone";
-		}
-		else if (y == 2 || y == 3) {
-			blockName = "dirt";
-		}
-		else {
-			blockName = "grass";
-		}
-		for (int x = -25; x < 25; x++) {
-			for (int z = -25; z < 25; z++) {
-				Chunk::addBlock(blockName, x, y, z);
-			}
-		}
+
+	// benchmarks (need the blocks registered by loadTextures)
+	if (RUN_BENCHMARKS) {
+		Benchmark::runAll();
 	}
 	
-	std::thread chunkLoader = std::thread(Chunk::updateChunksByNeighbor, Chunk::chunkList[Chunk::getChunkIndex(0, 0)]);
+	// chunks around the camera are loaded (or generated) as it moves
+	TerrainGenerator terrain(WORLD_SEED);
+	WorldStorage world(WORLD_DIRECTORY);
+	world.activate();
+	world.startSaving(AUTOSAVE_INTERVAL);
+	ChunkStreamer::init(&terrain);
 
 	// create and activate camera
-	Camera cam;
+	Camera cam(glm::vec3(0.5f, terrain.getHeight(0, 0) + 2, 0.5f));
 	cam.activate();
 
 	// start game loop
@@ -83,27 +99,95 @@ int main(void)
 
 	// timer for fps counter
 	double fpsTimer = glfwGetTime();
+	int intervalFrames = 0;		// frames drawn since the last fps printout
+	int intervalUploads = 0;	// chunk meshes uploaded since the last fps printout
+	size_t intervalUploadBytes = 0;		// mesh bytes uploaded since the last fps printout
+	int intervalLoads = 0;		// chunks loaded since the last fps printout
+	int intervalUnloads = 0;	// chunks unloaded since the last fps printout
+	int intervalCancels = 0;	// chunks cancelled since the last fps printout
+	int intervalDiskLoads = 0;		// chunks loaded from disk (instead of generated) since the last fps printout
+	double intervalMaxFrameTime = 0;	// longest frame (ms) since the last fps printout, saves shouldn't show up here
+	double streamStartTime = glfwGetTime();		// used to measure how long it takes until everything in view is drawn
+	bool fullView = false;		// whether or not everything in view has been drawn at least once
+	bool meshReportPending = false;		// the meshing mode was switched, the report is printed once every chunk is remeshed
 
 	/* Loop until the user closes the window */
 	while (!glfwWindowShouldClose(window)) {
+		PROFILE_ZONE("frame");
 		double renderStartTime = glfwGetTime();		// used to calculate how long each cycle of render loop took
 
 		/* Render here */
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
+		// the game thread owns the active camera, so draw a copy of its latest state
+		Camera drawCam = getRenderCamera();
+
+		// load and unload chunks around the camera
+		StreamStats streamStats = ChunkStreamer::update(&drawCam);
+		intervalLoads += streamStats.loaded;
+		intervalUnloads += streamStats.unloaded;
+		intervalCancels += streamStats.cancelled;
+		intervalDiskLoads += streamStats.loadedFromDisk;
+
 		// get camera matrix
-		glm::mat4 camMatrix = Camera::getActiveCam()->getMatrix();
+		glm::mat4 camMatrix = drawCam.getMatrix();
 
 		// draw chunks
-		drawChunks(shader.getProgramId(), camMatrix);
+		DrawStats drawStats = drawChunks(shader.getProgramId(), camMatrix);
+		intervalUploads += drawStats.uploads;
+		intervalUploadBytes += drawStats.uploadBytes;
+
+		// the view is full once every chunk in it is loaded, meshed and uploaded
+		if (!fullView && streamStats.chunks > 0 && streamStats.waitingInView == 0 && drawStats.chunksPending == 0 && drawStats.uploadsDeferred == 0) {
+			fullView = true;
+			printf("First full view after %f ms (%zu chunks loaded)\n", (glfwGetTime() - streamStartTime) * 1000, streamStats.chunks);
+		}
+
+		// delete chunks (and chunk list maps) which no thread can see anymore
+		Epoch::collect();
 		
 		/* Swap front and back buffers */
 		glfwSwapBuffers(window);
+		intervalMaxFrameTime = std::max(intervalMaxFrameTime, (glfwGetTime() - renderStartTime) * 1000);
+		intervalFrames++;
 
 		// update FPS timer if needed
 		if (SHOW_FPS && (glfwGetTime() - fpsTimer >= FPS_COUNTER_INTERVAL)) {
-			printf("FPS: %f, ms per frame: %f\n", 1.0f / ((glfwGetTime() - renderStartTime)), (glfwGetTime() - renderStartTime) * 1000);
+			// averaged over every frame since the last printout, not just the last one
+			double intervalTime = glfwGetTime() - fpsTimer;
+			printf("FPS: %f, ms per frame: %f (longest: %f)\n", intervalFrames / intervalTime, intervalTime * 1000 / intervalFrames, intervalMaxFrameTime);
+			printf("Chunks tested: %d, culled: %d, drawn: %d, draw calls: %d (%s)\n", drawStats.chunksTested, drawStats.chunksCulled,
+				drawStats.chunksTested - drawStats.chunksCulled, drawStats.drawCalls, getRenderPath() == RENDER_MULTI_DRAW ? "multi-draw" : "per chunk");
+			printf("Vertices: %zu, indices: %zu (vertices without indexing: %zu)\n", drawStats.vertices, drawStats.indices, drawStats.indices);
+			printf("Uploads: %d (%zu KB), deferred this frame: %d, staging used: %u KB, staging stalls: %d\n", intervalUploads, intervalUploadBytes / 1024,
+				drawStats.uploadsDeferred, StagingRing::getUsedBytes() / 1024, StagingRing::getStallCount());
+			printf("Chunks: %zu, loaded: %d (%d this frame, %d from disk), unloaded: %d (%d this frame), cancelled: %d\n", streamStats.chunks,
+				intervalLoads, streamStats.loaded, intervalDiskLoads, intervalUnloads, streamStats.unloaded, intervalCancels);
+			printf("Streaming queues: waiting: %d (%d in view), generating: %d, ready: %d, mesh waiting: %d, meshing: %d, chunks in view without a mesh: %d\n",
+				streamStats.waiting, streamStats.waitingInView, streamStats.generating, streamStats.ready, streamStats.meshWaiting, streamStats.meshing, drawStats.chunksPending);
+			SaveStats saveStats = world.getSaveStats();
+			printf("Saves: %d chunks written (%zu KB), queued: %d, autosaves: %d, last autosave: %d chunks in %f ms\n", saveStats.written, saveStats.bytesWritten / 1024,
+				saveStats.queued, saveStats.autosaves, saveStats.lastAutosaveChunks, saveStats.lastAutosaveMs);
+			TickStats tickStats = getTickStats();
+			printf("Ticks: %d (%d dropped), ms per tick: %f (longest: %f, latest start: %f), game thread cpu: %f%%\n", tickStats.ticks, tickStats.droppedTicks,
+				tickStats.averageTickMs, tickStats.maxTickMs, tickStats.maxLateMs, tickStats.cpuUsage * 100);
+			printf("Input: %d events (%d dropped), input to tick: %f ms (longest: %f), input to frame: %f ms (longest: %f)\n", tickStats.inputEvents,
+				tickStats.droppedInputEvents, tickStats.averageInputToTickMs, tickStats.maxInputToTickMs, tickStats.averageInputToFrameMs, tickStats.maxInputToFrameMs);
+			MeshPool::printStats();
+			meshReportPending = takeMeshReportRequest() || meshReportPending;
+			if (meshReportPending && Chunk::getOutdatedCount() == 0) {
+				Chunk::printMeshReport();
+				meshReportPending = false;
+			}
 			fpsTimer = glfwGetTime();
+			intervalUploads = 0;
+			intervalUploadBytes = 0;
+			intervalLoads = 0;
+			intervalUnloads = 0;
+			intervalCancels = 0;
+			intervalDiskLoads = 0;
+			intervalMaxFrameTime = 0;
+			intervalFrames = 0;
 		}
 
 		/* Poll for and process events */
@@ -114,7 +198,15 @@ int main(void)
 	gameThread->join();
 	delete gameThread;
 
-	chunkLoader.join();
+	// meshing jobs copy their meshes into the persistently mapped staging ring, so they have to finish before glfwTerminate unmaps it
+	jobs.wait();
+	ChunkStreamer::clear();
+
+	// save the loaded chunks which were edited since they were last saved (unloaded ones were queued when they were unloaded)
+	double saveStartTime = glfwGetTime();
+	int savedChunks = world.saveAll();
+	world.stopSaving();
+	printf("Saved %d edited chunks in %f ms\n", savedChunks, (glfwGetTime() - saveStartTime) * 1000);
 
 	glfwTerminate();
 	return 0;
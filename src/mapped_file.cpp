@@ -0,0 +1,143 @@
+#include <iostream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "mapped_file.h"
+
+#ifdef _WIN32
+MappedFile::MappedFile() : data(nullptr), size(0), fileHandle(INVALID_HANDLE_VALUE), mappingHandle(nullptr) {}
+#else
+MappedFile::MappedFile() : data(nullptr), size(0), fileDescriptor(-1) {}
+#endif
+
+MappedFile::~MappedFile() {
+	close();
+}
+
+#ifdef _WIN32
+bool MappedFile::dropCache(const std::string& path) {
+	// windows has no call to drop a single file's pages
+	return false;
+}
+
+bool MappedFile::open(const std::string& path) {
+	close();
+
+	// other handles may keep writing to the file while it is mapped
+	fileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, nullptr);
+	if (fileHandle == INVALID_HANDLE_VALUE) {
+		std::cerr << "Could not open " << path << " for mapping." << std::endl;
+		return false;
+	}
+
+	LARGE_INTEGER fileSize;
+	GetFileSizeEx(fileHandle, &fileSize);
+	size = (size_t) fileSize.QuadPart;
+	if (size == 0) {
+		return true;
+	}
+
+	mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mappingHandle != nullptr) {
+		data = (const uint8_t*) MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+	}
+	if (data == nullptr) {
+		std::cerr << "Could not map " << path << "." << std::endl;
+		close();
+		return false;
+	}
+
+	return true;
+}
+
+void MappedFile::close() {
+	if (data != nullptr) {
+		UnmapViewOfFile(data);
+	}
+	if (mappingHandle != nullptr) {
+		CloseHandle(mappingHandle);
+	}
+	if (fileHandle != INVALID_HANDLE_VALUE) {
+		CloseHandle(fileHandle);
+	}
+
+	data = nullptr;
+	size = 0;
+	mappingHandle = nullptr;
+	fileHandle = INVALID_HANDLE_VALUE;
+}
+#else
+bool MappedFile::dropCache(const std::string& path) {
+	int descriptor = ::open(path.c_str(), O_RDONLY);
+	if (descriptor < 0) {
+		return false;
+	}
+
+	// only clean pages are dropped, so written data has to reach the disk first
+	fdatasync(descriptor);
+	bool dropped = posix_fadvise(descriptor, 0, 0, POSIX_FADV_DONTNEED) == 0;
+	::close(descriptor);
+
+	return dropped;
+}
+
+bool MappedFile::open(const std::string& path) {
+	close();
+
+	fileDescriptor = ::open(path.c_str(), O_RDONLY);
+	if (fileDescriptor < 0) {
+		std::cerr << "Could not open " << path << " for mapping." << std::endl;
+		return false;
+	}
+
+	struct stat fileStat;
+	fstat(fileDescriptor, &fileStat);
+	size = fileStat.st_size;
+	if (size == 0) {
+		return true;
+	}
+
+	void* mapping = mmap(nullptr, size, PROT_READ, MAP_SHARED, fileDescriptor, 0);
+	if (mapping == MAP_FAILED) {
+		std::cerr << "Could not map " << path << "." << std::endl;
+		close();
+		return false;
+	}
+
+	// chunks are read one at a time from anywhere in the file
+	madvise(mapping, size, MADV_RANDOM);
+	data = (const uint8_t*) mapping;
+
+	return true;
+}
+
+void MappedFile::close() {
+	if (data != nullptr) {
+		munmap((void*) data, size);
+	}
+	if (fileDescriptor >= 0) {
+		::close(fileDescriptor);
+	}
+
+	data = nullptr;
+	size = 0;
+	fileDescriptor = -1;
+}
+#endif
+
+const uint8_t* MappedFile::getData() {
+	return data;
+}
+
+size_t MappedFile::getSize() {
+	return size;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+
+// read-only memory mapping of a whole file (mmap on posix, a file mapping view on windows)
+// pages are only read from disk when they are first touched, and the mapping is hinted for random access
+// so touching one page doesn't read ahead the rest of the file
+class MappedFile {
+private:
+	const uint8_t* data;	// start of the mapping, nullptr if nothing is mapped
+	size_t size;	// size of the mapping (bytes)
+#ifdef _WIN32
+	void* fileHandle;	// handles of the file and the mapping object
+	void* mappingHandle;
+#else
+	int fileDescriptor;		// descriptor of the mapped file
+#endif
+public:
+	static bool dropCache(const std::string& path);		// asks the os to drop the cached pages of a file, false if that isn't supported
+
+	MappedFile();
+	~MappedFile();	// unmaps the file
+
+	bool open(const std::string& path);		// maps the given file (unmapping the current one), false if it can't be mapped
+	void close();	// unmaps the file
+
+	const uint8_t* getData();	// returns the start of the mapping, nullptr if nothing is mapped
+	size_t getSize();		// returns the number of mapped bytes
+};
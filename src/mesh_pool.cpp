@@ -0,0 +1,93 @@
+#include <iostream>
+#include <GL/glew.h>
+
+#include "mesh_pool.h"
+
+GpuAllocator* MeshPool::allocator = nullptr;
+std::vector<unsigned int> MeshPool::arenaVaos = std::vector<unsigned int>();
+unsigned int MeshPool::drawPositionBufferId = 0;
+size_t MeshPool::drawPositionCapacity = 0;
+
+void MeshPool::init() {
+	// offsets stay multiples of the granularity, so they can always be turned into a base vertex
+	allocator = new GpuAllocator(MESH_ARENA_BYTES, MESH_MAX_ARENAS, MESH_POOL_GRANULARITY * sizeof(ChunkVertex));
+
+	glGenBuffers(1, &drawPositionBufferId);
+}
+
+void MeshPool::createArenaVao(int arena) {
+	unsigned int vaoId;
+	glGenVertexArrays(1, &vaoId);
+	arenaVaos.push_back(vaoId);
+
+	// set vertex attribs
+	glBindVertexArray(vaoId);
+	glBindBuffer(GL_ARRAY_BUFFER, allocator->getBuffer(arena));
+	setChunkVertexAttributes();
+
+	// all chunks draw using the same quad indices
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, getQuadIndexBuffer());
+
+	// chunk position advances once per instance, and each draw uses its own base instance
+	glBindBuffer(GL_ARRAY_BUFFER, drawPositionBufferId);
+	glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec4), (void*) 0);
+	glVertexAttribDivisor(3, 1);
+	glEnableVertexAttribArray(3);
+
+	glBindVertexArray(0);
+}
+
+bool MeshPool::allocate(unsigned int count, GpuAllocation& allocation) {
+	if (!allocator->allocate(count * sizeof(ChunkVertex), allocation)) {
+		return false;
+	}
+
+	// allocation may have created a new arena
+	while ((int) arenaVaos.size() < allocator->getArenaCount()) {
+		createArenaVao(arenaVaos.size());
+	}
+
+	return true;
+}
+
+void MeshPool::release(GpuAllocation& allocation) {
+	allocator->release(allocation);
+}
+
+void MeshPool::upload(const GpuAllocation& allocation, const ChunkVertex* verts, unsigned int count) {
+	glNamedBufferSubData(allocator->getBuffer(allocation.arena), allocation.offset, count * sizeof(ChunkVertex), verts);
+}
+
+void MeshPool::uploadStaged(const GpuAllocation& allocation, StagingRegion& region) {
+	StagingRing::copyToBuffer(region, allocator->getBuffer(allocation.arena), allocation.offset);
+}
+
+int MeshPool::getBaseVertex(const GpuAllocation& allocation) {
+	return allocation.offset / sizeof(ChunkVertex);
+}
+
+void MeshPool::setDrawPositions(const std::vector<glm::vec4>& positions) {
+	if (positions.empty()) {
+		return;
+	}
+
+	// grow the buffer if needed (vaos keep pointing at the same buffer id)
+	if (positions.size() > drawPositionCapacity) {
+		drawPositionCapacity = positions.size() * 2;
+		glNamedBufferData(drawPositionBufferId, drawPositionCapacity * sizeof(glm::vec4), nullptr, GL_STREAM_DRAW);
+	}
+
+	glNamedBufferSubData(drawPositionBufferId, 0, positions.size() * sizeof(glm::vec4), &positions[0]);
+}
+
+int MeshPool::getArenaCount() {
+	return arenaVaos.size();
+}
+
+unsigned int MeshPool::getVaoId(int arena) {
+	return arenaVaos[arena];
+}
+
+void MeshPool::printStats() {
+	allocator->printStats("Mesh pool");
+}
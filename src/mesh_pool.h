@@ -0,0 +1,38 @@
+#pragma once
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "drawing.h"
+#include "gpu_allocator.h"
+#include "staging_ring.h"
+
+#define MESH_ARENA_BYTES (16 * 1024 * 1024)		// size of each chunk vertex arena
+#define MESH_MAX_ARENAS 8		// most arenas the mesh pool will create
+#define MESH_POOL_GRANULARITY 64	// allocations are rounded up to a multiple of this many vertices, so small remeshes fit in place
+
+// holds the meshes of all chunks in a few large vertex buffers (arenas), sub-allocated with a GpuAllocator
+// each arena has one vao, so the visible chunks of an arena can be drawn with a single multi-draw call
+class MeshPool {
+private:
+	static GpuAllocator* allocator;		// allocator over the vertex arenas
+	static std::vector<unsigned int> arenaVaos;		// vao of each arena (vertex layout, shared quad indices and per-draw chunk positions)
+	static unsigned int drawPositionBufferId;	// buffer holding one chunk position per draw (read using the instance index)
+	static size_t drawPositionCapacity;		// number of positions which fit in the position buffer
+
+	static void createArenaVao(int arena);		// creates the vao of a newly created arena
+public:
+	static void init();		// creates the allocator and position buffer, must be called on the render thread after the opengl context exists
+
+	static bool allocate(unsigned int count, GpuAllocation& allocation);	// reserves room for at least count vertices, returns false if the pool is full
+	static void release(GpuAllocation& allocation);		// returns an allocation to the pool
+	static void upload(const GpuAllocation& allocation, const ChunkVertex* verts, unsigned int count);		// copies vertices to the start of an allocation
+	static void uploadStaged(const GpuAllocation& allocation, StagingRegion& region);		// copies a staged mesh to the start of an allocation, releasing the region once done
+	static int getBaseVertex(const GpuAllocation& allocation);		// returns the index of an allocation's first vertex in its arena
+
+	static void setDrawPositions(const std::vector<glm::vec4>& positions);		// sets the chunk position of each draw (baseInstance of draw i = i)
+	static int getArenaCount();		// returns the number of arenas
+	static unsigned int getVaoId(int arena);	// returns the vao to draw an arena's chunks with
+	static void printStats();	// prints usage and fragmentation of the pool
+};
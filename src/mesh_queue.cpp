@@ -0,0 +1,52 @@
+#include "mesh_queue.h"
+
+ChunkMesh::ChunkMesh() : next(nullptr), key(0), version(0), minHeight(0), maxHeight(0) {}
+
+ChunkMesh::~ChunkMesh() {
+	StagingRing::discard(staged);
+}
+
+MeshQueue::MeshQueue() : head(&stub), tail(&stub) {}
+
+void MeshQueue::push(ChunkMesh* mesh) {
+	mesh->next.store(nullptr, std::memory_order_relaxed);
+
+	// claim the head, then link the previous head to this mesh, the consumer waits for the link if it gets there first
+	ChunkMesh* previous = head.exchange(mesh, std::memory_order_acq_rel);
+	previous->next.store(mesh, std::memory_order_release);
+}
+
+ChunkMesh* MeshQueue::pop() {
+	ChunkMesh* oldest = tail;
+	ChunkMesh* next = oldest->next.load(std::memory_order_acquire);
+
+	// skip over the stub
+	if (oldest == &stub) {
+		if (next == nullptr) {
+			return nullptr;
+		}
+		tail = next;
+		oldest = next;
+		next = next->next.load(std::memory_order_acquire);
+	}
+
+	if (next != nullptr) {
+		tail = next;
+		return oldest;
+	}
+
+	// oldest is the last mesh, unless a producer has swapped the head but not linked it yet
+	if (oldest != head.load(std::memory_order_acquire)) {
+		return nullptr;
+	}
+
+	// put the stub back behind the last mesh, so it can be taken out
+	push(&stub);
+	next = oldest->next.load(std::memory_order_acquire);
+	if (next != nullptr) {
+		tail = next;
+		return oldest;
+	}
+
+	return nullptr;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <vector>
+#include <atomic>
+#include <cstdint>
+
+#include "vertex.h"
+#include "staging_ring.h"
+#include "chunk_registry.h"
+
+// a finished chunk mesh, built into its own buffers by a meshing worker and handed to the render thread
+struct ChunkMesh {
+	std::atomic<ChunkMesh*> next;	// link used by MeshQueue
+	ChunkKey key;	// key of the chunk this mesh belongs to
+	uint64_t version;	// meshes of a chunk are numbered in the order they were built, only the newest one is used
+	std::vector<ChunkVertex> verts;		// vertices of all exposed faces
+	StagingRegion staged;	// copy of verts in the staging ring (data = nullptr if it didn't fit, or it was given up)
+	int minHeight, maxHeight;	// y range [min, max) which contains all faces of this mesh
+
+	ChunkMesh();
+	~ChunkMesh();	// gives up the staging region if it wasn't copied
+};
+
+// lock-free queue of finished meshes with many producers (meshing workers) and a single consumer (the render thread)
+// meshes are linked through ChunkMesh::next, producers only swap the head, so a push never waits
+class MeshQueue {
+private:
+	alignas(64) std::atomic<ChunkMesh*> head;	// newest mesh, producers link themselves in here
+	alignas(64) ChunkMesh* tail;	// oldest mesh, only used by the consumer
+	ChunkMesh stub;		// placeholder which keeps the queue from ever being empty
+public:
+	MeshQueue();
+
+	void push(ChunkMesh* mesh);		// adds a mesh (any thread)
+	ChunkMesh* pop();	// returns the oldest mesh, nullptr if there is none or the next one is still being pushed (consumer only)
+};
@@ -0,0 +1,123 @@
+#include <iostream>
+#include <cstdio>
+#include <vector>
+#include <mutex>
+#include <algorithm>
+#include <thread>
+
+#include "profiler.h"
+
+// a zone copied out of a ring by writeTrace
+struct TraceZone {
+	const char* name;
+	uint64_t start, end;
+	int threadId;
+};
+
+static std::mutex buffersMutex;		// protects buffers and the thread names
+static std::vector<ProfileBuffer*> buffers;		// ring of every thread which recorded a zone, never freed since a thread can record until it exits
+
+static const uint64_t startTicks = Profiler::now();		// ticks and clock at startup, writeTrace measures the tick rate from here
+static const uint64_t startClockNs = Profiler::getClockNs();
+
+thread_local ProfileBuffer* Profiler::threadBuffer = nullptr;
+
+ProfileBuffer::ProfileBuffer(int threadId) : count(0), threadId(threadId) {}
+
+ProfileBuffer* Profiler::addThread() {
+	std::lock_guard<std::mutex> lock(buffersMutex);
+	threadBuffer = new ProfileBuffer((int) buffers.size() + 1);
+	buffers.push_back(threadBuffer);
+	return threadBuffer;
+}
+
+void Profiler::setThreadName(const char* name) {
+	ProfileBuffer* buffer = threadBuffer;
+	if (buffer == nullptr) {
+		buffer = addThread();
+	}
+
+	std::lock_guard<std::mutex> lock(buffersMutex);
+	buffer->threadName = name;
+}
+
+bool Profiler::writeTrace(const std::string& path) {
+	std::vector<TraceZone> zones;
+	std::vector<std::pair<int, std::string>> threadNames;
+	size_t threadCount;
+	{
+		std::lock_guard<std::mutex> lock(buffersMutex);
+		threadCount = buffers.size();
+		for (ProfileBuffer* buffer : buffers) {
+			if (!buffer->threadName.empty()) {
+				threadNames.push_back(std::make_pair(buffer->threadId, buffer->threadName));
+			}
+
+			// the thread keeps recording while its ring is copied, so copy the newest zones, then drop the ones which may have been
+			// overwritten in the meantime
+			uint64_t count = buffer->count.load(std::memory_order_acquire);
+			uint64_t first = (count > PROFILER_BUFFER_EVENTS) ? count - PROFILER_BUFFER_EVENTS : 0;
+			size_t copyStart = zones.size();
+			for (uint64_t i = first; i < count; i++) {
+				ProfileEvent& event = buffer->events[i & (PROFILER_BUFFER_EVENTS - 1)];
+				TraceZone zone;
+				zone.name = event.name.load(std::memory_order_relaxed);
+				zone.start = event.start.load(std::memory_order_relaxed);
+				zone.end = event.end.load(std::memory_order_relaxed);
+				zone.threadId = buffer->threadId;
+				zones.push_back(zone);
+			}
+
+			std::atomic_thread_fence(std::memory_order_acquire);
+			uint64_t newCount = buffer->count.load(std::memory_order_acquire);
+			uint64_t overwritten = (newCount > PROFILER_BUFFER_EVENTS) ? newCount - PROFILER_BUFFER_EVENTS : 0;
+			if (overwritten > first) {
+				size_t dropped = (size_t) std::min(overwritten - first, count - first);
+				zones.erase(zones.begin() + copyStart, zones.begin() + copyStart + dropped);
+			}
+		}
+	}
+
+	FILE* file = fopen(path.c_str(), "w");
+	if (file == nullptr) {
+		std::cerr << "Could not open " << path << " to write the trace." << std::endl;
+		return false;
+	}
+
+	// ticks per nanosecond (1 without a time stamp counter), measured against the os clock since startup
+	if (getClockNs() - startClockNs < PROFILER_CALIBRATION_MS * 1000000ULL) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(PROFILER_CALIBRATION_MS));
+	}
+	uint64_t ticks = now() - startTicks;
+	uint64_t clockNs = getClockNs() - startClockNs;
+	double nsPerTick = PROFILER_TSC ? (double) clockNs / ticks : 1.0;
+
+	// times are in microseconds from the earliest zone, with the nanoseconds kept as decimals
+	uint64_t origin = UINT64_MAX;
+	for (TraceZone& zone : zones) {
+		origin = std::min(origin, zone.start);
+	}
+
+	fprintf(file, "{\"traceEvents\":[\n");
+	bool first = true;
+	for (std::pair<int, std::string>& threadName : threadNames) {
+		fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}", first ? "" : ",\n",
+			threadName.first, threadName.second.c_str());
+		first = false;
+	}
+	for (TraceZone& zone : zones) {
+		fprintf(file, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}", first ? "" : ",\n", zone.name, zone.threadId,
+			(zone.start - origin) * nsPerTick / 1000, (zone.end - zone.start) * nsPerTick / 1000);
+		first = false;
+	}
+	fprintf(file, "\n]}\n");
+
+	bool written = !ferror(file);
+	if (fclose(file) != 0 || !written) {
+		std::cerr << "Could not write the trace to " << path << "." << std::endl;
+		return false;
+	}
+
+	printf("Wrote %zu zones from %zu threads to %s\n", zones.size(), threadCount, path.c_str());
+	return true;
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <string>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#define PROFILER_ENABLED 1		// 0 compiles every profiler macro out (zones then cost nothing)
+#define PROFILER_BUFFER_EVENTS 65536	// zones kept per thread, older ones are overwritten (a power of 2)
+#define PROFILER_TRACE_PATH "trace.json"		// where the trace is written when it is requested in game
+#define PROFILER_CALIBRATION_MS 20		// writeTrace measures the tick rate over at least this long
+
+// zones are timed with the cpu's time stamp counter where there is one, since it's several times cheaper to read than the os clock
+// (the ticks are converted to nanoseconds when the trace is written), other targets use the os clock directly
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define PROFILER_TSC true
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#else
+#define PROFILER_TSC false
+#endif
+
+#if PROFILER_ENABLED
+#define PROFILER_CONCAT_HELPER(a, b) a##b
+#define PROFILER_CONCAT(a, b) PROFILER_CONCAT_HELPER(a, b)
+
+// times the rest of the enclosing scope as a zone called name (a string literal)
+#define PROFILE_ZONE(name) ProfileZone PROFILER_CONCAT(profileZone, __LINE__)(name)
+// names the calling thread in the trace (the name is copied)
+#define PROFILE_THREAD(name) Profiler::setThreadName(name)
+#else
+#define PROFILE_ZONE(name) ((void) 0)
+#define PROFILE_THREAD(name) ((void) 0)
+#endif
+
+// a finished zone, the fields are atomic (relaxed, so plain stores) since writeTrace may read a slot while its thread overwrites it
+struct ProfileEvent {
+	std::atomic<const char*> name;
+	std::atomic<uint64_t> start;	// ticks, see Profiler::now
+	std::atomic<uint64_t> end;
+};
+
+// ring of the latest zones of one thread, only that thread writes to it
+struct ProfileBuffer {
+	alignas(64) std::atomic<uint64_t> count;	// number of zones recorded so far, the newest is at (count - 1) % PROFILER_BUFFER_EVENTS
+	int threadId;	// small number used as the thread id in the trace
+	std::string threadName;		// set with PROFILE_THREAD, empty if it never was (protected by the profiler's mutex)
+	ProfileEvent events[PROFILER_BUFFER_EVENTS];
+
+	ProfileBuffer(int threadId);
+};
+
+// records named zones of code into a ring per thread, and writes them out as a chrome trace (load it in chrome://tracing or ui.perfetto.dev)
+// recording a zone only reads the clock twice and fills the thread's next slot, no locks are taken after a thread's first zone
+class Profiler {
+private:
+	static thread_local ProfileBuffer* threadBuffer;	// ring of the calling thread, nullptr until its first zone
+
+	static ProfileBuffer* addThread();		// creates and registers a ring for the calling thread
+public:
+	static uint64_t now();	// ticks since an arbitrary point (steady, the same for every thread), time stamp counter cycles or nanoseconds without one
+	static uint64_t getClockNs();		// nanoseconds of the os clock since an arbitrary point, used to convert ticks
+	static void record(const char* name, uint64_t start, uint64_t end);		// adds a finished zone to the calling thread's ring
+	static void setThreadName(const char* name);	// names the calling thread in the trace
+
+	static bool writeTrace(const std::string& path);	// writes every thread's recorded zones as chrome trace json, false if the file couldn't be written (any thread)
+};
+
+// zone which is recorded when it goes out of scope, see PROFILE_ZONE
+class ProfileZone {
+private:
+	const char* name;
+	uint64_t start;
+public:
+	ProfileZone(const char* name) : name(name), start(Profiler::now()) {}
+	~ProfileZone() { Profiler::record(name, start, Profiler::now()); }
+};
+
+inline uint64_t Profiler::now() {
+#if PROFILER_TSC
+	return __rdtsc();
+#else
+	return getClockNs();
+#endif
+}
+
+inline uint64_t Profiler::getClockNs() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+inline void Profiler::record(const char* name, uint64_t start, uint64_t end) {
+	ProfileBuffer* buffer = threadBuffer;
+	if (buffer == nullptr) {
+		buffer = addThread();
+	}
+
+	// fill the slot, then publish it by advancing the count
+	uint64_t count = buffer->count.load(std::memory_order_relaxed);
+	ProfileEvent& event = buffer->events[count & (PROFILER_BUFFER_EVENTS - 1)];
+	event.name.store(name, std::memory_order_relaxed);
+	event.start.store(start, std::memory_order_relaxed);
+	event.end.store(end, std::memory_order_relaxed);
+	buffer->count.store(count + 1, std::memory_order_release);
+}
@@ -0,0 +1,184 @@
+#include <iostream>
+#include <cstring>
+#include <mutex>
+
+#include "region_file.h"
+
+static_assert(8 + REGION_CHUNK_COUNT * 8 <= REGION_HEADER_SECTORS * REGION_SECTOR_BYTES, "the region header has to fit in its sectors");
+
+RegionFile::RegionFile() : file(nullptr), entries(), sectorCount(0) {}
+
+RegionFile::~RegionFile() {
+	close();
+}
+
+bool RegionFile::open(const std::string& filePath) {
+	close();
+	path = filePath;
+
+	file = fopen(path.c_str(), "r+b");
+	if (file == nullptr) {
+		// new region, the header is all zeros apart from the magic and version
+		file = fopen(path.c_str(), "w+b");
+		if (file == nullptr) {
+			std::cerr << "Could not create region file " << path << "." << std::endl;
+			return false;
+		}
+
+		std::vector<uint8_t> header = std::vector<uint8_t>(REGION_HEADER_SECTORS * REGION_SECTOR_BYTES, 0);
+		uint32_t magic = REGION_MAGIC;
+		uint32_t version = REGION_VERSION;
+		memcpy(&header[0], &magic, 4);
+		memcpy(&header[4], &version, 4);
+		fwrite(header.data(), 1, header.size(), file);
+		fflush(file);
+		sectorCount = REGION_HEADER_SECTORS;
+		usedSectors.assign(sectorCount, false);
+		markSectors(0, REGION_HEADER_SECTORS, true);
+	}
+	else {
+		uint32_t magic = 0;
+		uint32_t version = 0;
+		if (fread(&magic, 4, 1, file) != 1 || fread(&version, 4, 1, file) != 1 || fread(entries, sizeof(entries), 1, file) != 1 ||
+			magic != REGION_MAGIC || version != REGION_VERSION) {
+			std::cerr << "Region file " << path << " is damaged or from another version." << std::endl;
+			close();
+			return false;
+		}
+
+		fseek(file, 0, SEEK_END);
+		sectorCount = (ftell(file) + REGION_SECTOR_BYTES - 1) / REGION_SECTOR_BYTES;
+
+		// forget entries which point outside the file, and mark the sectors of the others as used
+		usedSectors.assign(sectorCount, false);
+		markSectors(0, REGION_HEADER_SECTORS, true);
+		for (RegionEntry& entry : entries) {
+			uint32_t sectors = (entry.length + REGION_SECTOR_BYTES - 1) / REGION_SECTOR_BYTES;
+			if (entry.sector != 0 && (entry.sector < REGION_HEADER_SECTORS || entry.sector + sectors > sectorCount)) {
+				std::cerr << "Region file " << path << " has a chunk outside the file, it will be regenerated." << std::endl;
+				entry.sector = 0;
+				entry.length = 0;
+			}
+			if (entry.sector != 0) {
+				markSectors(entry.sector, sectors, true);
+			}
+		}
+	}
+
+	return mapping.open(path);
+}
+
+void RegionFile::close() {
+	mapping.close();
+	if (file != nullptr) {
+		fclose(file);
+		file = nullptr;
+	}
+}
+
+bool RegionFile::hasChunk(int index) {
+	std::shared_lock<std::shared_mutex> lock(mutex);
+	return entries[index].sector != 0;
+}
+
+bool RegionFile::readChunk(int index, BlockStorage& storage) {
+	std::shared_lock<std::shared_mutex> lock(mutex);
+	RegionEntry entry = entries[index];
+	if (entry.sector == 0) {
+		return false;
+	}
+
+	// the storage is filled straight from the mapped pages
+	size_t offset = (size_t) entry.sector * REGION_SECTOR_BYTES;
+	if (mapping.getData() == nullptr || offset + entry.length > mapping.getSize()) {
+		return false;
+	}
+	if (!storage.deserialize(mapping.getData() + offset, entry.length)) {
+		std::cerr << "Chunk " << index << " of region file " << path << " is damaged." << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+bool RegionFile::writeChunk(int index, const std::vector<uint8_t>& bytes) {
+	std::unique_lock<std::shared_mutex> lock(mutex);
+	if (file == nullptr) {
+		return false;
+	}
+
+	// never write over the saved copy: the chunk goes into free sectors (the old ones are still marked used), at the end of the file if
+	// no free run is long enough
+	RegionEntry& entry = entries[index];
+	uint32_t sectors = (bytes.size() + REGION_SECTOR_BYTES - 1) / REGION_SECTOR_BYTES;
+	uint32_t oldSectors = (entry.length + REGION_SECTOR_BYTES - 1) / REGION_SECTOR_BYTES;
+	uint32_t sector = findFreeSectors(sectors);
+	bool grows = sector + sectors > sectorCount;
+
+	// the data has to be in the file before the offset table points at it, a failed write leaves the old copy in place
+	std::vector<uint8_t> padded = bytes;
+	padded.resize((size_t) sectors * REGION_SECTOR_BYTES, 0);
+	fseek(file, (long) sector * REGION_SECTOR_BYTES, SEEK_SET);
+	if (fwrite(padded.data(), 1, padded.size(), file) != padded.size() || fflush(file) != 0) {
+		std::cerr << "Could not write to region file " << path << "." << std::endl;
+		return false;
+	}
+	if (grows) {
+		sectorCount = sector + sectors;
+	}
+	markSectors(sector, sectors, true);
+
+	RegionEntry newEntry = { sector, (uint32_t) bytes.size() };
+	fseek(file, 8 + index * sizeof(RegionEntry), SEEK_SET);
+	if (fwrite(&newEntry, sizeof(RegionEntry), 1, file) != 1 || fflush(file) != 0) {
+		std::cerr << "Could not write to region file " << path << "." << std::endl;
+		markSectors(sector, sectors, false);
+		return false;
+	}
+
+	// the old copy's sectors can be reused now
+	if (entry.sector != 0) {
+		markSectors(entry.sector, oldSectors, false);
+	}
+	entry = newEntry;
+
+	// readers need a mapping which covers the new sectors
+	if (grows) {
+		mapping.open(path);
+	}
+
+	return true;
+}
+
+uint32_t RegionFile::findFreeSectors(uint32_t count) {
+	uint32_t runStart = REGION_HEADER_SECTORS;
+	for (uint32_t sector = REGION_HEADER_SECTORS; sector < sectorCount; sector++) {
+		if (usedSectors[sector]) {
+			runStart = sector + 1;
+		}
+		else if (sector + 1 - runStart == count) {
+			return runStart;
+		}
+	}
+
+	// a free run at the end of the file can be extended past it
+	return runStart;
+}
+
+void RegionFile::markSectors(uint32_t sector, uint32_t count, bool used) {
+	if (sector + count > usedSectors.size()) {
+		usedSectors.resize(sector + count, false);
+	}
+	for (uint32_t i = sector; i < sector + count; i++) {
+		usedSectors[i] = used;
+	}
+}
+
+int RegionFile::getSectorCount() {
+	std::shared_lock<std::shared_mutex> lock(mutex);
+	return sectorCount;
+}
+
+std::string RegionFile::getPath() {
+	return path;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+#include <shared_mutex>
+
+#include "block_storage.h"
+#include "mapped_file.h"
+
+#define REGION_CHUNKS 32	// a region file holds REGION_CHUNKS x REGION_CHUNKS chunks
+#define REGION_CHUNK_COUNT (REGION_CHUNKS * REGION_CHUNKS)		// number of chunks in a region
+#define REGION_SECTOR_BYTES 4096	// chunks are stored in whole sectors of this size (one page), so reading a chunk touches as few pages as possible
+#define REGION_HEADER_SECTORS 3		// the header (magic, version and offset table) takes this many sectors
+#define REGION_MAGIC 0x4E474552		// "REGN" at the start of every region file
+#define REGION_VERSION 1	// version of the region file format
+
+// one file holding the serialized block storage (see BlockStorage::serialize) of up to REGION_CHUNK_COUNT chunks
+// layout: magic (uint32), version (uint32), offset table of REGION_CHUNK_COUNT (sector, length) uint32 pairs,
+// then the chunks, each starting on a sector boundary and padded to whole sectors
+// reads deserialize straight out of a memory mapping of the file, writes go through normal file writes
+// a chunk is always written to free sectors before the offset table points at it, so the old copy stays intact until the new one is
+// complete, and the old sectors are then free for later writes (the file only grows when no free run is long enough)
+class RegionFile {
+private:
+	// where a chunk is in the file, sector 0 means the chunk isn't saved
+	struct RegionEntry {
+		uint32_t sector;
+		uint32_t length;	// bytes
+	};
+
+	std::string path;	// path of the file
+	FILE* file;		// used for writing
+	MappedFile mapping;		// used for reading, remapped whenever the file grows
+	std::shared_mutex mutex;	// readers hold it shared, writers exclusively
+	RegionEntry entries[REGION_CHUNK_COUNT];	// copy of the offset table
+	uint32_t sectorCount;	// number of sectors in the file
+	std::vector<bool> usedSectors;		// whether or not each sector of the file holds the header or a chunk in the offset table
+
+	uint32_t findFreeSectors(uint32_t count);	// returns the first sector of the first run of count free sectors, sectorCount if there is none
+	void markSectors(uint32_t sector, uint32_t count, bool used);		// marks count sectors from sector as used or free, growing usedSectors if needed
+public:
+	RegionFile();
+	~RegionFile();		// closes the file
+
+	bool open(const std::string& filePath);		// opens the given region file, creating it if it doesn't exist, false if it can't be used
+	void close();	// closes the file
+
+	bool hasChunk(int index);	// whether or not the chunk at the given index (x * REGION_CHUNKS + z within the region) is saved
+	bool readChunk(int index, BlockStorage& storage);	// reads a saved chunk into the given storage, false if it isn't saved or is damaged
+	bool writeChunk(int index, const std::vector<uint8_t>& bytes);		// saves a chunk, replacing the saved copy
+
+	int getSectorCount();	// returns the number of sectors in the file
+	std::string getPath();		// returns the path of the file
+};
@@ -0,0 +1,170 @@
+#include <iostream>
+
+#include "staging_ring.h"
+
+unsigned int StagingRing::bufferId = 0;
+unsigned char* StagingRing::mapped = nullptr;
+std::mutex StagingRing::mutex;
+std::deque<StagingRing::RegionEntry> StagingRing::regions = std::deque<StagingRing::RegionEntry>();
+unsigned int StagingRing::head = 0;
+unsigned int StagingRing::nextId = 1;
+int StagingRing::stallCount = 0;
+
+void StagingRing::init() {
+	GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+	// immutable storage which stays mapped for the whole program
+	glCreateBuffers(1, &bufferId);
+	glNamedBufferStorage(bufferId, STAGING_RING_BYTES, nullptr, flags);
+	mapped = (unsigned char*) glMapNamedBufferRange(bufferId, 0, STAGING_RING_BYTES, flags);
+
+	if (mapped == nullptr) {
+		std::cerr << "Could not map staging buffer, chunk meshes will be uploaded directly." << std::endl;
+	}
+}
+
+StagingRing::RegionEntry* StagingRing::findRegion(unsigned int id) {
+	// ids are consecutive, so the position in the deque follows from the oldest id
+	if (regions.empty() || id < regions.front().id || id - regions.front().id >= regions.size()) {
+		return nullptr;
+	}
+
+	return &regions[id - regions.front().id];
+}
+
+bool StagingRing::reserve(unsigned int size, StagingRegion& region) {
+	// ring doesn't exist (e.g. no opengl context)
+	if (mapped == nullptr) {
+		return false;
+	}
+
+	size = (size + STAGING_ALIGNMENT - 1) / STAGING_ALIGNMENT * STAGING_ALIGNMENT;
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	// oldest byte still in use, an empty ring starts over at 0
+	if (regions.empty()) {
+		head = 0;
+	}
+	unsigned int tail = regions.empty() ? 0 : regions.front().offset;
+	bool full = !regions.empty() && head == tail;
+
+	unsigned int offset;
+	if (!full && head >= tail) {
+		// free space is from head to the end, then from the start to tail
+		if (size <= STAGING_RING_BYTES - head) {
+			offset = head;
+		}
+		else if (size < tail) {
+			// skip the end of the ring with a padding region
+			regions.push_back({ nextId++, head, STAGING_RING_BYTES - head, FREE, nullptr });
+			offset = 0;
+		}
+		else {
+			stallCount++;
+			return false;
+		}
+	}
+	else if (!full && head + size < tail) {
+		// free space is between head and tail
+		offset = head;
+	}
+	else {
+		stallCount++;
+		return false;
+	}
+
+	regions.push_back({ nextId, offset, size, RESERVED, nullptr });
+	head = (offset + size) % STAGING_RING_BYTES;
+
+	region.id = nextId++;
+	region.offset = offset;
+	region.size = size;
+	region.data = mapped + offset;
+
+	return true;
+}
+
+void StagingRing::discard(StagingRegion& region) {
+	if (region.data == nullptr) {
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	RegionEntry* entry = findRegion(region.id);
+	if (entry != nullptr) {
+		entry->state = FREE;
+	}
+
+	region = StagingRegion();
+}
+
+void StagingRing::copyToBuffer(StagingRegion& region, unsigned int destBufferId, unsigned int offset) {
+	if (region.data == nullptr) {
+		return;
+	}
+
+	// coherent mapping, so the producer's writes are visible to this copy
+	glCopyNamedBufferSubData(bufferId, destBufferId, region.offset, offset, region.size);
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	RegionEntry* entry = findRegion(region.id);
+	if (entry != nullptr) {
+		entry->state = COPIED;
+	}
+
+	region = StagingRegion();
+}
+
+void StagingRing::beginFrame() {
+	std::lock_guard<std::mutex> lock(mutex);
+
+	// reclaim from the oldest region until one is still needed
+	while (!regions.empty()) {
+		RegionEntry& entry = regions.front();
+
+		if (entry.state == FENCED) {
+			// check without waiting
+			GLenum status = glClientWaitSync(entry.fence, 0, 0);
+			if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+				break;
+			}
+			glDeleteSync(entry.fence);
+		}
+		else if (entry.state != FREE) {
+			break;
+		}
+
+		regions.pop_front();
+	}
+}
+
+void StagingRing::endFrame() {
+	std::lock_guard<std::mutex> lock(mutex);
+
+	// fence the copies issued this frame, each region gets its own sync object since it is deleted when reclaimed
+	for (RegionEntry& entry : regions) {
+		if (entry.state == COPIED) {
+			entry.state = FENCED;
+			entry.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		}
+	}
+}
+
+int StagingRing::getStallCount() {
+	std::lock_guard<std::mutex> lock(mutex);
+	return stallCount;
+}
+
+unsigned int StagingRing::getUsedBytes() {
+	std::lock_guard<std::mutex> lock(mutex);
+
+	if (regions.empty()) {
+		return 0;
+	}
+
+	unsigned int tail = regions.front().offset;
+	return (head > tail) ? head - tail : STAGING_RING_BYTES - tail + head;
+}
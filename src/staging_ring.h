@@ -0,0 +1,60 @@
+#pragma once
+
+#include <deque>
+#include <mutex>
+
+#include <GL/glew.h>
+
+#define STAGING_RING_BYTES (8 * 1024 * 1024)	// size of the persistently mapped staging buffer
+#define STAGING_ALIGNMENT 16	// every region starts at a multiple of this many bytes
+
+// a range of the staging ring reserved by a producer
+struct StagingRegion {
+	unsigned int id;	// sequence number of the region, used to find it in the ring
+	unsigned int offset;	// position in the ring (bytes)
+	unsigned int size;		// size of the region (bytes)
+	void* data;		// mapped pointer to write to, nullptr if nothing is reserved
+
+	StagingRegion() : id(0), offset(0), size(0), data(nullptr) {}
+};
+
+// persistently mapped, coherent ring buffer used to upload chunk meshes
+// any thread can reserve a region and write into it directly, the render thread then only issues gpu copies out of it
+// regions are handed out in ring order and reclaimed in the same order once the fence of the frame which copied them has signaled,
+// so a region should be copied (or discarded) soon after it is reserved, a region which is held on to keeps every later one from being reused
+// (meshes waiting too long for their upload give theirs up, see ChunkRenderState::waitFrame)
+class StagingRing {
+private:
+	// states of a region in the ring
+	enum RegionState { RESERVED, COPIED, FENCED, FREE };
+
+	// bookkeeping for one region (or one padding region when the ring wraps)
+	struct RegionEntry {
+		unsigned int id;
+		unsigned int offset, size;
+		RegionState state;
+		GLsync fence;	// fence of the frame which copied this region (only when FENCED)
+	};
+
+	static unsigned int bufferId;	// the staging buffer
+	static unsigned char* mapped;	// persistent mapping of the whole buffer
+	static std::mutex mutex;	// protects everything below, reserve can be called from any thread
+	static std::deque<RegionEntry> regions;		// all regions which aren't reclaimed yet, oldest first
+	static unsigned int head;	// position of the next region
+	static unsigned int nextId;		// id of the next region
+	static int stallCount;	// number of times a reservation failed because the ring was full
+
+	static RegionEntry* findRegion(unsigned int id);	// returns the entry of a region (nullptr if already reclaimed), mutex must be held
+public:
+	static void init();		// creates and maps the buffer, must be called on the render thread after the opengl context exists
+
+	static bool reserve(unsigned int size, StagingRegion& region);		// reserves a region (any thread), returns false and counts a stall if the ring is full
+	static void discard(StagingRegion& region);		// gives up a region which won't be copied (any thread)
+	static void copyToBuffer(StagingRegion& region, unsigned int bufferId, unsigned int offset);		// copies a region into a buffer and releases it once the copy is done (render thread)
+
+	static void beginFrame();	// reclaims regions whose copies have finished (render thread)
+	static void endFrame();		// fences the regions copied this frame (render thread)
+
+	static int getStallCount();		// returns the number of failed reservations so far
+	static unsigned int getUsedBytes();		// returns the number of bytes not yet reclaimed
+};
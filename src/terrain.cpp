@@ -0,0 +1,335 @@
+#include <algorithm>
+
+#include "terrain.h"
+#include "chunk.h"
+#include "profiler.h"
+
+// sse2 intrinsics, only included once terrain.h has decided if they are available
+#if TERRAIN_SIMD
+#include <emmintrin.h>
+#endif
+
+// multipliers of the lattice hash, one per axis
+#define HASH_X 374761393u
+#define HASH_Y 2246822519u
+#define HASH_Z 668265263u
+#define HASH_MIX 1274126177u
+
+// every helper below has a scalar and an sse2 version which do the same operations in the same order,
+// so both give bit-identical results
+
+static inline int fastFloor(float x) {
+	int i = (int) x;
+	return (x < i) ? i - 1 : i;
+}
+
+static inline float fade(float t) {
+	return t * t * t * (t * (t * 6 - 15) + 10);
+}
+
+static inline float lerp(float a, float b, float t) {
+	return a + t * (b - a);
+}
+
+static inline uint32_t finishHash(uint32_t h) {
+	h = (h ^ (h >> 13)) * HASH_MIX;
+	return h ^ (h >> 16);
+}
+
+// gradient (+-1, +-1) picked by the low hash bits
+static inline float grad2(uint32_t h, float x, float z) {
+	return ((h & 1) ? -x : x) + ((h & 2) ? -z : z);
+}
+
+// gradient (+-1, +-1, +-1) picked by the low hash bits
+static inline float grad3(uint32_t h, float x, float y, float z) {
+	return ((h & 1) ? -x : x) + ((h & 2) ? -y : y) + ((h & 4) ? -z : z);
+}
+
+#if TERRAIN_SIMD
+// sse2 has no 32-bit multiply, so the even and odd lanes are multiplied separately and put back together
+static inline __m128i mullo32(__m128i a, __m128i b) {
+	__m128i even = _mm_mul_epu32(a, b);
+	__m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+	return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+static inline __m128i fastFloor4(__m128 x) {
+	// truncate, then subtract 1 (add the all-ones compare mask) where that rounded up
+	__m128i i = _mm_cvttps_epi32(x);
+	return _mm_add_epi32(i, _mm_castps_si128(_mm_cmplt_ps(x, _mm_cvtepi32_ps(i))));
+}
+
+static inline __m128 fade4(__m128 t) {
+	__m128 inner = _mm_add_ps(_mm_mul_ps(t, _mm_sub_ps(_mm_mul_ps(t, _mm_set1_ps(6)), _mm_set1_ps(15))), _mm_set1_ps(10));
+	return _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(t, t), t), inner);
+}
+
+static inline __m128 lerp4(__m128 a, __m128 b, __m128 t) {
+	return _mm_add_ps(a, _mm_mul_ps(t, _mm_sub_ps(b, a)));
+}
+
+static inline __m128i finishHash4(__m128i h) {
+	h = mullo32(_mm_xor_si128(h, _mm_srli_epi32(h, 13)), _mm_set1_epi32((int) HASH_MIX));
+	return _mm_xor_si128(h, _mm_srli_epi32(h, 16));
+}
+
+// flips the sign of x where the given hash bit is set
+static inline __m128 flipSign4(__m128i h, int bit, __m128 x) {
+	__m128i sign = _mm_slli_epi32(_mm_and_si128(_mm_srli_epi32(h, bit), _mm_set1_epi32(1)), 31);
+	return _mm_xor_ps(x, _mm_castsi128_ps(sign));
+}
+
+static inline __m128 grad2x4(__m128i h, __m128 x, __m128 z) {
+	return _mm_add_ps(flipSign4(h, 0, x), flipSign4(h, 1, z));
+}
+
+static inline __m128 grad3x4(__m128i h, __m128 x, __m128 y, __m128 z) {
+	return _mm_add_ps(_mm_add_ps(flipSign4(h, 0, x), flipSign4(h, 1, y)), flipSign4(h, 2, z));
+}
+#endif
+
+TerrainGenerator::TerrainGenerator(uint32_t seed, bool useSimd) : seed(seed), useSimd(useSimd && TERRAIN_SIMD) {
+	stone = Block::getBlockId("stone");
+	dirt = Block::getBlockId("dirt");
+	grass = Block::getBlockId("grass");
+}
+
+float TerrainGenerator::noise2(float x, float z, uint32_t noiseSeed) {
+	int ix = fastFloor(x);
+	int iz = fastFloor(z);
+	float fx = x - ix;
+	float fz = z - iz;
+	float u = fade(fx);
+	float w = fade(fz);
+
+	// hashes of the 4 surrounding lattice points
+	uint32_t rowHash = noiseSeed + (uint32_t) iz * HASH_Z;
+	uint32_t nextRowHash = noiseSeed + (uint32_t) (iz + 1) * HASH_Z;
+	uint32_t h00 = finishHash(rowHash + (uint32_t) ix * HASH_X);
+	uint32_t h10 = finishHash(rowHash + (uint32_t) (ix + 1) * HASH_X);
+	uint32_t h01 = finishHash(nextRowHash + (uint32_t) ix * HASH_X);
+	uint32_t h11 = finishHash(nextRowHash + (uint32_t) (ix + 1) * HASH_X);
+
+	float a = lerp(grad2(h00, fx, fz), grad2(h10, fx - 1, fz), u);
+	float b = lerp(grad2(h01, fx, fz - 1), grad2(h11, fx - 1, fz - 1), u);
+	return lerp(a, b, w);
+}
+
+float TerrainGenerator::noise3(float x, float y, float z, uint32_t noiseSeed) {
+	int ix = fastFloor(x);
+	int iy = fastFloor(y);
+	int iz = fastFloor(z);
+	float fx = x - ix;
+	float fy = y - iy;
+	float fz = z - iz;
+	float u = fade(fx);
+	float v = fade(fy);
+	float w = fade(fz);
+
+	// blend the 8 corners along x, then y, then z
+	float layers[2];
+	for (int dz = 0; dz < 2; dz++) {
+		float rows[2];
+		for (int dy = 0; dy < 2; dy++) {
+			uint32_t rowHash = noiseSeed + (uint32_t) (iy + dy) * HASH_Y + (uint32_t) (iz + dz) * HASH_Z;
+			uint32_t h0 = finishHash(rowHash + (uint32_t) ix * HASH_X);
+			uint32_t h1 = finishHash(rowHash + (uint32_t) (ix + 1) * HASH_X);
+			rows[dy] = lerp(grad3(h0, fx, fy - dy, fz - dz), grad3(h1, fx - 1, fy - dy, fz - dz), u);
+		}
+		layers[dz] = lerp(rows[0], rows[1], v);
+	}
+
+	return lerp(layers[0], layers[1], w);
+}
+
+void TerrainGenerator::noise2x4(const float* x, float z, uint32_t noiseSeed, float* out) {
+#if TERRAIN_SIMD
+	if (useSimd) {
+		__m128 xs = _mm_loadu_ps(x);
+		__m128i ix = fastFloor4(xs);
+		__m128 fx = _mm_sub_ps(xs, _mm_cvtepi32_ps(ix));
+		__m128 fx1 = _mm_sub_ps(fx, _mm_set1_ps(1));
+		__m128 u = fade4(fx);
+
+		// z is the same for all lanes
+		int iz = fastFloor(z);
+		float fz = z - iz;
+		__m128 fz0 = _mm_set1_ps(fz);
+		__m128 fz1 = _mm_set1_ps(fz - 1);
+		__m128 w = _mm_set1_ps(fade(fz));
+
+		__m128i xHash = mullo32(ix, _mm_set1_epi32((int) HASH_X));
+		__m128i nextXHash = _mm_add_epi32(xHash, _mm_set1_epi32((int) HASH_X));
+		__m128i rowHash = _mm_set1_epi32((int) (noiseSeed + (uint32_t) iz * HASH_Z));
+		__m128i nextRowHash = _mm_set1_epi32((int) (noiseSeed + (uint32_t) (iz + 1) * HASH_Z));
+
+		__m128i h00 = finishHash4(_mm_add_epi32(rowHash, xHash));
+		__m128i h10 = finishHash4(_mm_add_epi32(rowHash, nextXHash));
+		__m128i h01 = finishHash4(_mm_add_epi32(nextRowHash, xHash));
+		__m128i h11 = finishHash4(_mm_add_epi32(nextRowHash, nextXHash));
+
+		__m128 a = lerp4(grad2x4(h00, fx, fz0), grad2x4(h10, fx1, fz0), u);
+		__m128 b = lerp4(grad2x4(h01, fx, fz1), grad2x4(h11, fx1, fz1), u);
+		_mm_storeu_ps(out, lerp4(a, b, w));
+		return;
+	}
+#endif
+
+	for (int i = 0; i < 4; i++) {
+		out[i] = noise2(x[i], z, noiseSeed);
+	}
+}
+
+void TerrainGenerator::noise3x4(const float* x, float y, float z, uint32_t noiseSeed, float* out) {
+#if TERRAIN_SIMD
+	if (useSimd) {
+		__m128 xs = _mm_loadu_ps(x);
+		__m128i ix = fastFloor4(xs);
+		__m128 fx = _mm_sub_ps(xs, _mm_cvtepi32_ps(ix));
+		__m128 fx1 = _mm_sub_ps(fx, _mm_set1_ps(1));
+		__m128 u = fade4(fx);
+
+		// y and z are the same for all lanes
+		int iy = fastFloor(y);
+		int iz = fastFloor(z);
+		float fy = y - iy;
+		float fz = z - iz;
+		__m128 v = _mm_set1_ps(fade(fy));
+		__m128 w = _mm_set1_ps(fade(fz));
+
+		__m128i xHash = mullo32(ix, _mm_set1_epi32((int) HASH_X));
+		__m128i nextXHash = _mm_add_epi32(xHash, _mm_set1_epi32((int) HASH_X));
+
+		__m128 layers[2];
+		for (int dz = 0; dz < 2; dz++) {
+			__m128 rows[2];
+			__m128 cornerZ = _mm_set1_ps(fz - dz);
+			for (int dy = 0; dy < 2; dy++) {
+				__m128 cornerY = _mm_set1_ps(fy - dy);
+				__m128i rowHash = _mm_set1_epi32((int) (noiseSeed + (uint32_t) (iy + dy) * HASH_Y + (uint32_t) (iz + dz) * HASH_Z));
+				__m128i h0 = finishHash4(_mm_add_epi32(rowHash, xHash));
+				__m128i h1 = finishHash4(_mm_add_epi32(rowHash, nextXHash));
+				rows[dy] = lerp4(grad3x4(h0, fx, cornerY, cornerZ), grad3x4(h1, fx1, cornerY, cornerZ), u);
+			}
+			layers[dz] = lerp4(rows[0], rows[1], v);
+		}
+		_mm_storeu_ps(out, lerp4(layers[0], layers[1], w));
+		return;
+	}
+#endif
+
+	for (int i = 0; i < 4; i++) {
+		out[i] = noise3(x[i], y, z, noiseSeed);
+	}
+}
+
+void TerrainGenerator::getHeights(int chunkX, int chunkZ, int* heights) {
+	static_assert(CHUNK_SIZE % 4 == 0, "terrain noise is evaluated 4 columns at a time");
+
+	for (int z = 0; z < CHUNK_SIZE; z++) {
+		float total[CHUNK_SIZE] = {};
+		float frequency = TERRAIN_SCALE;
+		float amplitude = 1;
+		float amplitudeSum = 0;
+
+		// each octave has twice the frequency and half the amplitude of the one before
+		for (int octave = 0; octave < TERRAIN_OCTAVES; octave++) {
+			uint32_t octaveSeed = seed + octave * 0x9E3779B9u;
+			for (int x = 0; x < CHUNK_SIZE; x += 4) {
+				float xs[4], values[4];
+				for (int i = 0; i < 4; i++) {
+					xs[i] = (chunkX + x + i) * frequency;
+				}
+				noise2x4(xs, (chunkZ + z) * frequency, octaveSeed, values);
+
+				for (int i = 0; i < 4; i++) {
+					total[x + i] += values[i] * amplitude;
+				}
+			}
+
+			amplitudeSum += amplitude;
+			frequency *= 2;
+			amplitude *= 0.5f;
+		}
+
+		for (int x = 0; x < CHUNK_SIZE; x++) {
+			int height = TERRAIN_BASE_HEIGHT + fastFloor(total[x] / amplitudeSum * TERRAIN_HEIGHT_RANGE);
+			heights[x * CHUNK_SIZE + z] = std::max(1, std::min(height, WORLD_HEIGHT - 1));
+		}
+	}
+}
+
+void TerrainGenerator::generateBlocks(int chunkX, int chunkZ, BlockId* ids) {
+	PROFILE_ZONE("TerrainGenerator::generateBlocks");
+
+	int heights[CHUNK_SIZE * CHUNK_SIZE];
+	getHeights(chunkX, chunkZ, heights);
+
+	// fill every column up to its height, in storage order
+	int maxHeight = 0;
+	for (int x = 0; x < CHUNK_SIZE; x++) {
+		for (int z = 0; z < CHUNK_SIZE; z++) {
+			int height = heights[x * CHUNK_SIZE + z];
+			BlockId* column = ids + (x * CHUNK_SIZE + z) * WORLD_HEIGHT;
+			maxHeight = std::max(maxHeight, height);
+
+			for (int y = 0; y < WORLD_HEIGHT; y++) {
+				if (y >= height) {
+					column[y] = BLOCK_AIR;
+				}
+				else if (y == height - 1) {
+					column[y] = grass;
+				}
+				else if (y >= height - TERRAIN_DIRT_DEPTH) {
+					column[y] = dirt;
+				}
+				else {
+					column[y] = stone;
+				}
+			}
+		}
+	}
+
+	// carve caves, one row of x positions at a time (the bottom layer is never carved)
+	uint32_t caveSeed = seed ^ 0x85EBCA6Bu;
+	for (int z = 0; z < CHUNK_SIZE; z++) {
+		for (int y = 1; y < maxHeight; y++) {
+			for (int x = 0; x < CHUNK_SIZE; x += 4) {
+				float xs[4], values[4];
+				for (int i = 0; i < 4; i++) {
+					xs[i] = (chunkX + x + i) * TERRAIN_CAVE_SCALE;
+				}
+				noise3x4(xs, y * TERRAIN_CAVE_SCALE, (chunkZ + z) * TERRAIN_CAVE_SCALE, caveSeed, values);
+
+				for (int i = 0; i < 4; i++) {
+					if (values[i] > TERRAIN_CAVE_THRESHOLD) {
+						ids[((x + i) * CHUNK_SIZE + z) * WORLD_HEIGHT + y] = BLOCK_AIR;
+					}
+				}
+			}
+		}
+	}
+}
+
+void TerrainGenerator::generateChunk(Chunk* chunk) {
+	glm::ivec3 chunkPos = chunk->getPosition();
+
+	BlockId ids[CHUNK_VOLUME];
+	generateBlocks(chunkPos.x, chunkPos.z, ids);
+	chunk->setBlocks(ids);
+}
+
+int TerrainGenerator::getHeight(int x, int z) {
+	int chunkX, chunkZ;
+	Chunk::getChunkPosition(x, z, chunkX, chunkZ);
+
+	int heights[CHUNK_SIZE * CHUNK_SIZE];
+	getHeights(chunkX, chunkZ, heights);
+
+	return heights[(x - chunkX) * CHUNK_SIZE + (z - chunkZ)];
+}
+
+uint32_t TerrainGenerator::getSeed() {
+	return seed;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+
+#include "block.h"
+
+// sse2 is part of every x64 cpu, other targets use the scalar noise
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TERRAIN_SIMD true
+#else
+#define TERRAIN_SIMD false
+#endif
+
+#define TERRAIN_OCTAVES 4		// number of noise layers added together for the height map
+#define TERRAIN_SCALE 0.015f	// frequency of the first height octave (per block)
+#define TERRAIN_BASE_HEIGHT 10	// average surface height
+#define TERRAIN_HEIGHT_RANGE 16		// the surface varies up to this many blocks above and below the base height
+#define TERRAIN_DIRT_DEPTH 3	// number of dirt blocks (including the grass) on top of the stone
+#define TERRAIN_CAVE_SCALE 0.08f	// frequency of the cave noise (per block)
+#define TERRAIN_CAVE_THRESHOLD 0.35f	// positions where the cave noise is above this are left empty
+
+// forward declarations
+class Chunk;
+
+// seeded procedural terrain: a height map from 2D gradient noise with octaves, with caves carved out by 3D gradient noise
+// the noise is evaluated for 4 x positions at once with sse2, and the simd and scalar paths give identical results,
+// so a seed always produces the same world
+class TerrainGenerator {
+private:
+	uint32_t seed;		// seed of all noise
+	bool useSimd;		// whether or not the sse2 noise is used
+	BlockId stone, dirt, grass;		// ids of the blocks terrain is made of
+
+	static float noise2(float x, float z, uint32_t noiseSeed);	// 2D gradient noise at (x, z), roughly in [-1, 1]
+	static float noise3(float x, float y, float z, uint32_t noiseSeed);		// 3D gradient noise at (x, y, z), roughly in [-1.5, 1.5]
+	void noise2x4(const float* x, float z, uint32_t noiseSeed, float* out);		// noise2 at 4 x positions (sse2 if enabled)
+	void noise3x4(const float* x, float y, float z, uint32_t noiseSeed, float* out);	// noise3 at 4 x positions (sse2 if enabled)
+
+	void getHeights(int chunkX, int chunkZ, int* heights);		// surface height of each (x, z) column of the chunk at (chunkX, chunkZ), indexed x * CHUNK_SIZE + z
+public:
+	TerrainGenerator(uint32_t seed, bool useSimd = TERRAIN_SIMD);	// the block ids are looked up, so blocks have to be registered first
+
+	void generateBlocks(int chunkX, int chunkZ, BlockId* ids);		// writes the CHUNK_VOLUME block ids of the chunk at (chunkX, chunkZ) in block index order (any thread)
+	void generateChunk(Chunk* chunk);	// fills a whole chunk (replacing its blocks) in one pass
+	int getHeight(int x, int z);	// returns the surface height at global position (x, z)
+	uint32_t getSeed();		// returns the seed
+};
@@ -12,15 +12,6 @@ std::map<std::string, unsigned int>& getTextureMap() {
 	return textureMap;
 }
 
-std::map<std::string, BlockTexture>& getBlockTextures() {
-	static std::map<std::string, BlockTexture> blockTextures;
-	return blockTextures;
-}
-
-void addBlockTexture(std::string blockName, BlockTexture texture) {
-	getBlockTextures().insert(std::pair<std::string, BlockTexture>(blockName, texture));
-}
-
 void loadTextures() {
 	// block textures
 	// sprite sheet offset (should have one entry for each block in the spritesheet)
@@ -29,10 +20,10 @@ void loadTextures() {
 	Block::addBlockTextureOffset("grass", 0, 1);
 	Block::addBlockTextureOffset("stone", 1, 1);
 
-	// textures for each block
-	addBlockTexture("dirt", BlockTexture("dirt"));
-	addBlockTexture("stone", BlockTexture("stone"));
-	addBlockTexture("grass", BlockTexture("grass", "dirt", "grass_side", "grass_side", "grass_side", "grass_side"));
+	// register each block with its textures (ids are assigned in this order)
+	Block::registerBlock("dirt", BlockTexture("dirt"));
+	Block::registerBlock("stone", BlockTexture("stone"));
+	Block::registerBlock("grass", BlockTexture("grass", "dirt", "grass_side", "grass_side", "grass_side", "grass_side"));
 
 	Block::loadSpritesheet();
 }
@@ -21,9 +21,6 @@ struct BlockTexture {
 
 std::map<std::string, unsigned int>& getTextureMap();	// returns the map which contains all texture names mapped to their open gl ids
 
-std::map<std::string, BlockTexture>& getBlockTextures();	// returns the map which contains block names mapped to textures
-void addBlockTexture(std::string blockName, BlockTexture texture);		// add a block texture to the map
-
 void loadTextures();	// all texture loading should be done here
 
 unsigned int getTextureId(std::string name);		// returns the id associated with this texture name
@@ -0,0 +1,27 @@
+#include "vertex.h"
+
+std::ostream& operator<<(std::ostream& out, Vertex& vert) {
+	out << "Vertex: [position: (" << vert.pos[0] << ", " << vert.pos[1] << ", " << vert.pos[2] << "), "
+		<< "texture coords: (" << vert.texturePos[0] << ", " << vert.texturePos[1] << "), "
+		<< "sprite offset: (" << vert.spriteOffset[0] << ", " << vert.spriteOffset[1] << ")]";
+	return out;
+}
+
+PackedVertex::PackedVertex(const Vertex& vert, int face) {
+	// all values are whole numbers, so they can be converted directly
+	data[0] = (uint32_t) vert.pos[0]
+		| ((uint32_t) vert.pos[1] << 5)
+		| ((uint32_t) vert.pos[2] << 11)
+		| ((uint32_t) face << 16)
+		| ((uint32_t) vert.texturePos[0] << 19)
+		| ((uint32_t) vert.texturePos[1] << 25);
+	data[1] = (uint32_t) vert.spriteOffset[0] | ((uint32_t) vert.spriteOffset[1] << 8);
+}
+
+std::ostream& operator<<(std::ostream& out, PackedVertex& vert) {
+	out << "PackedVertex: [position: (" << (vert.data[0] & 31) << ", " << ((vert.data[0] >> 5) & 63) << ", " << ((vert.data[0] >> 11) & 31) << "), "
+		<< "face: " << ((vert.data[0] >> 16) & 7) << ", "
+		<< "texture coords: (" << ((vert.data[0] >> 19) & 63) << ", " << ((vert.data[0] >> 25) & 63) << "), "
+		<< "sprite offset: (" << (vert.data[1] & 255) << ", " << ((vert.data[1] >> 8) & 255) << ")]";
+	return out;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <iostream>
+#include <cstdint>
+
+#define PACKED_VERTICES true	// chunk meshes use PackedVertex (false = float Vertex, easier to inspect when debugging)
+
+// standard vertex for use with VBOs
+struct Vertex{
+	float pos[3];		// position of vertex
+	float texturePos[2];	// texture coordinates within a sprite, repeats every 1 unit (so merged faces tile)
+	float spriteOffset[2];	// position of the sprite in the spritesheet (in sprites, not pixels)
+
+	friend std::ostream& operator<<(std::ostream& out, Vertex& vert);
+};
+
+// compact chunk vertex (8 bytes instead of 20), decoded in shader_vertex.glsl
+// every value is a small integer since chunk meshes use chunk-local positions and whole sprites
+//	data[0]: x (bits 0-4), y (5-10), z (11-15), face (16-18), texture u (19-24), texture v (25-30)
+//	data[1]: sprite u offset (bits 0-7), sprite v offset (8-15)
+struct PackedVertex {
+	uint32_t data[2];
+
+	PackedVertex(const Vertex& vert, int face);		// packs a chunk vertex, face = FACE_* the vertex belongs to
+
+	friend std::ostream& operator<<(std::ostream& out, PackedVertex& vert);
+};
+
+// vertex type used by chunk meshes
+#if PACKED_VERTICES
+typedef PackedVertex ChunkVertex;
+#else
+typedef Vertex ChunkVertex;
+#endif
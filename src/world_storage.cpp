@@ -0,0 +1,362 @@
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#include "world_storage.h"
+#include "region_file.h"
+#include "chunk.h"
+#include "epoch.h"
+#include "profiler.h"
+
+WorldStorage* WorldStorage::activeStorage = nullptr;
+
+WorldStorage* WorldStorage::getActive() {
+	return activeStorage;
+}
+
+WorldStorage::WorldStorage(const std::string& worldDirectory) : directory(worldDirectory), sameIds(true), saveThreadRunning(false), stopSaveThread(false), autosaveInterval(0) {
+	std::error_code error;
+	std::filesystem::create_directories(directory, error);
+	if (error) {
+		std::cerr << "Could not create world directory " << directory << ": " << error.message() << std::endl;
+	}
+
+	// names of the saved ids, a new world saves with the current ids
+	std::ifstream tableFile = std::ifstream(directory + "/" + WORLD_BLOCK_TABLE);
+	std::string name;
+	while (std::getline(tableFile, name)) {
+		savedNames.push_back(name);
+	}
+	bool tableChanged = savedNames.empty();
+
+	// current blocks which aren't in the table yet get the next saved ids
+	std::map<std::string, BlockId> currentIds;
+	saveIds = std::vector<BlockId>(Block::getBlockCount());
+	for (int id = 0; id < Block::getBlockCount(); id++) {
+		name = Block::getBlockName(id);
+		currentIds[name] = id;
+
+		std::vector<std::string>::iterator saved = std::find(savedNames.begin(), savedNames.end(), name);
+		if (saved == savedNames.end()) {
+			saved = savedNames.insert(savedNames.end(), name);
+			tableChanged = true;
+		}
+		saveIds[id] = saved - savedNames.begin();
+		sameIds = sameIds && saveIds[id] == id;
+	}
+
+	// saved blocks which aren't registered anymore load as air
+	loadIds = std::vector<BlockId>(savedNames.size(), BLOCK_AIR);
+	for (int savedId = 0; savedId < (int) savedNames.size(); savedId++) {
+		std::map<std::string, BlockId>::iterator current = currentIds.find(savedNames[savedId]);
+		if (current == currentIds.end()) {
+			std::cerr << "Saved block \"" << savedNames[savedId] << "\" is not registered, it will be loaded as air." << std::endl;
+			sameIds = false;
+			continue;
+		}
+		loadIds[savedId] = current->second;
+	}
+
+	if (tableChanged) {
+		writeBlockTable();
+	}
+}
+
+WorldStorage::~WorldStorage() {
+	stopSaving();
+	closeRegions();
+
+	if (activeStorage == this) {
+		activeStorage = nullptr;
+	}
+}
+
+void WorldStorage::activate() {
+	activeStorage = this;
+}
+
+void WorldStorage::startSaving(double interval) {
+	if (saveThread.joinable()) {
+		std::cerr << "The save thread of " << directory << " is already running." << std::endl;
+		return;
+	}
+
+	autosaveInterval = interval;
+	stopSaveThread = false;
+	saveThreadRunning = true;
+	saveThread = std::thread(&WorldStorage::runSaveThread, this);
+}
+
+void WorldStorage::stopSaving() {
+	if (!saveThread.joinable()) {
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(saveMutex);
+		stopSaveThread = true;
+	}
+	saveCondition.notify_all();
+	saveThread.join();
+}
+
+void WorldStorage::runSaveThread() {
+	PROFILE_THREAD("save");
+
+	std::chrono::steady_clock::duration interval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(autosaveInterval));
+	std::chrono::steady_clock::time_point nextAutosave = std::chrono::steady_clock::now() + interval;
+
+	std::unique_lock<std::mutex> lock(saveMutex);
+	while (true) {
+		saveCondition.wait_until(lock, nextAutosave, [this] { return stopSaveThread || !queuedSaves.empty(); });
+
+		if (!queuedSaves.empty()) {
+			writeQueuedChunks(lock);
+			continue;
+		}
+		if (stopSaveThread) {
+			// saves queued from now on are written by the threads queueing them
+			saveThreadRunning = false;
+			return;
+		}
+		if (std::chrono::steady_clock::now() < nextAutosave) {
+			continue;
+		}
+
+		// autosave, the edited chunks are snapshotted here so the threads editing them only ever wait for a copy of one chunk
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		lock.unlock();
+		int queued = queueEditedChunks();
+		lock.lock();
+		writeQueuedChunks(lock);
+
+		saveStats.autosaves++;
+		saveStats.lastAutosaveChunks = queued;
+		saveStats.lastAutosaveMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		nextAutosave = start + interval;
+	}
+}
+
+void WorldStorage::writeQueuedChunks(std::unique_lock<std::mutex>& lock) {
+	PROFILE_ZONE("WorldStorage::writeQueuedChunks");
+
+	// loads find the snapshots in writingSaves until they are on disk
+	writingSaves.swap(queuedSaves);
+	lock.unlock();
+	size_t bytes = 0;
+	for (std::pair<const ChunkKey, std::vector<uint8_t>>& save : writingSaves) {
+		writeChunk(save.first, save.second);
+		bytes += save.second.size();
+	}
+	lock.lock();
+
+	saveStats.written += writingSaves.size();
+	saveStats.bytesWritten += bytes;
+	writingSaves.clear();
+	saveCondition.notify_all();
+}
+
+bool WorldStorage::writeBlockTable() {
+	std::ofstream tableFile = std::ofstream(directory + "/" + WORLD_BLOCK_TABLE, std::ios::trunc);
+	for (std::string& name : savedNames) {
+		tableFile << name << "\n";
+	}
+
+	if (!tableFile) {
+		std::cerr << "Could not write the block table of " << directory << "." << std::endl;
+		return false;
+	}
+	return true;
+}
+
+RegionFile* WorldStorage::getRegion(int chunkX, int chunkZ, bool create, int& index) {
+	// chunk positions are multiples of CHUNK_SIZE, the shifts round down for negative positions too
+	int gridX = chunkX / CHUNK_SIZE;
+	int gridZ = chunkZ / CHUNK_SIZE;
+	int regionX = gridX >> 5;
+	int regionZ = gridZ >> 5;
+	static_assert(REGION_CHUNKS == 32, "the region position is found with a shift by 5");
+	index = (gridX & (REGION_CHUNKS - 1)) * REGION_CHUNKS + (gridZ & (REGION_CHUNKS - 1));
+
+	std::lock_guard<std::mutex> lock(regionMutex);
+	uint64_t key = ((uint64_t) (uint32_t) regionX << 32) | (uint32_t) regionZ;
+	std::map<uint64_t, RegionFile*>::iterator found = regions.find(key);
+	if (found != regions.end()) {
+		return found->second;
+	}
+
+	// regions which were never saved don't get a file just for a load
+	std::string path = directory + "/r." + std::to_string(regionX) + "." + std::to_string(regionZ) + ".region";
+	if (!create && !std::filesystem::exists(path)) {
+		return nullptr;
+	}
+
+	RegionFile* region = new RegionFile();
+	if (!region->open(path)) {
+		delete region;
+		return nullptr;
+	}
+	regions[key] = region;
+
+	return region;
+}
+
+bool WorldStorage::loadChunk(int chunkX, int chunkZ, BlockId* ids) {
+	// a chunk which was unloaded just now may not be written yet, its snapshot is newer than the saved copy
+	BlockStorage storage = BlockStorage(CHUNK_VOLUME);
+	std::vector<uint8_t> queued;
+	if (findQueuedChunk(Chunk::getChunkIndex(chunkX, chunkZ), queued)) {
+		if (!storage.deserialize(queued.data(), queued.size())) {
+			return false;
+		}
+	}
+	else {
+		int index;
+		RegionFile* region = getRegion(chunkX, chunkZ, false, index);
+		if (region == nullptr || !region->readChunk(index, storage)) {
+			return false;
+		}
+	}
+	storage.getAll(ids);
+
+	// saved ids to current ids
+	if (!sameIds) {
+		for (int i = 0; i < CHUNK_VOLUME; i++) {
+			ids[i] = (ids[i] < loadIds.size()) ? loadIds[ids[i]] : BLOCK_AIR;
+		}
+	}
+
+	return true;
+}
+
+void WorldStorage::serializeChunk(Chunk* chunk, std::vector<uint8_t>& bytes) {
+	chunk->serialize(bytes);
+
+	// current ids to saved ids, only the palette holds ids (see BlockStorage::serialize)
+	if (!sameIds) {
+		uint16_t paletteSize;
+		memcpy(&paletteSize, bytes.data(), sizeof(paletteSize));
+		for (int i = 0; i < paletteSize; i++) {
+			BlockId id;
+			memcpy(&id, &bytes[4 + i * sizeof(BlockId)], sizeof(BlockId));
+			id = saveIds[id];
+			memcpy(&bytes[4 + i * sizeof(BlockId)], &id, sizeof(BlockId));
+		}
+	}
+}
+
+bool WorldStorage::writeChunk(ChunkKey key, const std::vector<uint8_t>& bytes) {
+	int index;
+	RegionFile* region = getRegion((int) (uint32_t) (key >> 32), (int) (uint32_t) key, true, index);
+	if (region == nullptr) {
+		return false;
+	}
+
+	return region->writeChunk(index, bytes);
+}
+
+bool WorldStorage::findQueuedChunk(ChunkKey key, std::vector<uint8_t>& bytes) {
+	std::lock_guard<std::mutex> lock(saveMutex);
+	std::map<ChunkKey, std::vector<uint8_t>>::iterator found = queuedSaves.find(key);
+	if (found == queuedSaves.end()) {
+		found = writingSaves.find(key);
+		if (found == writingSaves.end()) {
+			return false;
+		}
+	}
+
+	bytes = found->second;
+	return true;
+}
+
+bool WorldStorage::saveChunk(Chunk* chunk) {
+	// an edit after this still marks the chunk again
+	chunk->takeSaveDirty();
+
+	std::vector<uint8_t> bytes;
+	serializeChunk(chunk, bytes);
+	glm::ivec3 pos = chunk->getPosition();
+	return writeChunk(Chunk::getChunkIndex(pos.x, pos.z), bytes);
+}
+
+bool WorldStorage::queueSave(Chunk* chunk) {
+	if (!chunk->takeSaveDirty()) {
+		return false;
+	}
+
+	std::vector<uint8_t> bytes;
+	serializeChunk(chunk, bytes);
+	glm::ivec3 pos = chunk->getPosition();
+	ChunkKey key = Chunk::getChunkIndex(pos.x, pos.z);
+
+	{
+		std::lock_guard<std::mutex> lock(saveMutex);
+		if (saveThreadRunning) {
+			queuedSaves[key] = std::move(bytes);
+			saveCondition.notify_all();
+			return true;
+		}
+	}
+
+	writeChunk(key, bytes);
+	return true;
+}
+
+bool WorldStorage::hasChunk(int chunkX, int chunkZ) {
+	std::vector<uint8_t> queued;
+	if (findQueuedChunk(Chunk::getChunkIndex(chunkX, chunkZ), queued)) {
+		return true;
+	}
+
+	int index;
+	RegionFile* region = getRegion(chunkX, chunkZ, false, index);
+	return region != nullptr && region->hasChunk(index);
+}
+
+int WorldStorage::queueEditedChunks() {
+	EpochGuard guard;
+	std::vector<Chunk*> chunks;
+	Chunk::chunkList.getAll(chunks);
+
+	int queued = 0;
+	for (Chunk* chunk : chunks) {
+		if (queueSave(chunk)) {
+			queued++;
+		}
+	}
+
+	return queued;
+}
+
+int WorldStorage::saveAll() {
+	int saved = queueEditedChunks();
+	flush();
+	return saved;
+}
+
+void WorldStorage::flush() {
+	std::unique_lock<std::mutex> lock(saveMutex);
+	saveCondition.wait(lock, [this] { return queuedSaves.empty() && writingSaves.empty(); });
+}
+
+SaveStats WorldStorage::getSaveStats() {
+	std::lock_guard<std::mutex> lock(saveMutex);
+	SaveStats stats = saveStats;
+	stats.queued = queuedSaves.size() + writingSaves.size();
+	return stats;
+}
+
+void WorldStorage::closeRegions() {
+	std::lock_guard<std::mutex> lock(regionMutex);
+	for (std::pair<const uint64_t, RegionFile*>& region : regions) {
+		delete region.second;
+	}
+	regions.clear();
+}
+
+std::string WorldStorage::getDirectory() {
+	return directory;
+}
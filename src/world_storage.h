@@ -0,0 +1,91 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <cstdint>
+
+#include "block.h"
+#include "chunk_registry.h"
+
+#define WORLD_BLOCK_TABLE "blocks.txt"		// file in the world directory which lists the saved block names, one per line in saved id order
+
+// forward declarations
+class Chunk;
+class RegionFile;
+class BlockStorage;
+
+// chunks written by the save thread since the storage was opened, and the last autosave
+struct SaveStats {
+	int queued;		// number of chunks waiting for the save thread
+	int written;	// number of chunks written
+	size_t bytesWritten;	// number of serialized chunk bytes written
+	int autosaves;		// number of autosaves run
+	int lastAutosaveChunks;		// number of edited chunks saved by the last autosave
+	double lastAutosaveMs;		// how long the last autosave took on the save thread (ms)
+
+	SaveStats() : queued(0), written(0), bytesWritten(0), autosaves(0), lastAutosaveChunks(0), lastAutosaveMs(0) {}
+};
+
+// the chunks of a world saved in region files (see region_file.h) inside one directory
+// saved chunks use their own block ids, which are looked up by name in the block table when the world is opened,
+// so the block registry can change between runs (the table only ever grows)
+// only edited chunks are saved (see Chunk::takeSaveDirty), the others are generated again from the seed when they are loaded
+// saves are snapshots of the chunk's blocks, written by a save thread (see startSaving) so no other thread waits for the disk,
+// which also saves every edited chunk in the world at a fixed interval
+class WorldStorage {
+private:
+	static WorldStorage* activeStorage;		// storage used by the chunk streamer
+
+	std::string directory;		// the world directory
+	std::vector<std::string> savedNames;	// name of each saved id
+	std::vector<BlockId> loadIds;	// current id of each saved id
+	std::vector<BlockId> saveIds;	// saved id of each current id
+	bool sameIds;	// whether or not saved ids and current ids are the same, so nothing has to be translated
+
+	std::mutex regionMutex;		// protects regions
+	std::map<uint64_t, RegionFile*> regions;	// open region files, by region position
+
+	std::thread saveThread;		// runs runSaveThread between startSaving and stopSaving
+	std::mutex saveMutex;		// protects the members below
+	std::condition_variable saveCondition;		// signalled when chunks are queued, written or the save thread has to stop
+	std::map<ChunkKey, std::vector<uint8_t>> queuedSaves;		// serialized chunks (saved ids) waiting for the save thread, only the newest snapshot of a chunk is kept
+	std::map<ChunkKey, std::vector<uint8_t>> writingSaves;		// serialized chunks the save thread is writing now
+	bool saveThreadRunning;		// whether or not the save thread takes queued chunks
+	bool stopSaveThread;	// whether or not the save thread has to write what is queued and end
+	double autosaveInterval;	// seconds between autosaves
+	SaveStats saveStats;	// see SaveStats, queued is filled in by getSaveStats
+
+	bool writeBlockTable();		// writes savedNames to the block table
+	RegionFile* getRegion(int chunkX, int chunkZ, bool create, int& index);		// returns the region file containing the given chunk, and the chunk's index in it (nullptr if it doesn't exist and create is false)
+	void serializeChunk(Chunk* chunk, std::vector<uint8_t>& bytes);		// serializes a chunk with saved ids
+	bool writeChunk(ChunkKey key, const std::vector<uint8_t>& bytes);	// writes a serialized chunk to its region file
+	bool findQueuedChunk(ChunkKey key, std::vector<uint8_t>& bytes);	// copies the newest queued or writing snapshot of a chunk, false if there is none
+	int queueEditedChunks();	// queues every edited chunk in the chunk list, returns the number queued
+	void writeQueuedChunks(std::unique_lock<std::mutex>& lock);		// writes the queued chunks, lock holds saveMutex and is released while writing
+	void runSaveThread();	// writes queued chunks as they come in and autosaves every autosaveInterval seconds, until stopSaveThread is set
+public:
+	static WorldStorage* getActive();	// returns the active storage, nullptr if there is none
+
+	WorldStorage(const std::string& worldDirectory);	// opens (or creates) the world in the given directory, blocks have to be registered first
+	~WorldStorage();	// writes the queued chunks, stops the save thread and closes the region files
+
+	void activate();	// select this storage for the chunk streamer
+	void startSaving(double interval);		// starts the save thread, which autosaves the edited chunks every interval seconds
+	void stopSaving();		// writes the queued chunks and stops the save thread
+
+	bool loadChunk(int chunkX, int chunkZ, BlockId* ids);	// writes the CHUNK_VOLUME saved ids of the chunk at (chunkX, chunkZ) in block index order, false if it isn't saved (any thread)
+	bool saveChunk(Chunk* chunk);	// saves a chunk right away, replacing its saved copy, whether or not it was edited (any thread)
+	bool queueSave(Chunk* chunk);	// snapshots the chunk for the save thread if it was edited (written right away if the save thread isn't running), returns whether or not it was (any thread)
+	bool hasChunk(int chunkX, int chunkZ);		// whether or not the chunk at (chunkX, chunkZ) is saved
+	int saveAll();		// saves every edited chunk in the chunk list and waits until they are written, returns the number saved
+	void flush();	// waits until the save thread has written every queued chunk
+	void closeRegions();	// closes all region files, they are opened again when needed (no loads or saves may be running)
+
+	SaveStats getSaveStats();	// returns the save thread's stats
+
+	std::string getDirectory();		// returns the world directory
+};